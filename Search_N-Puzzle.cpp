@@ -1,372 +1,6565 @@
-#include <chrono>
-#include <thread>
-#include <iostream>
-#include <vector>
-#include <string>
-#include <cmath>
-#include <algorithm>
-#include <queue>
-#include <map>
-using namespace std;
-
-const int PUZZLE_SIDE_LENGTH = 3;   // For a 3x3 puzzle. Can be changed for different puzzle sizes.
-
-// Goal state; 0 is the blank tile. Can be changed for different puzzle sizes.
-const vector<vector<int>> PUZZLE_GOAL = {{1, 2, 3},
-                                         {4, 5, 6},
-                                         {7, 8, 0}};
-
-struct PuzzleNode {
-    vector<vector<int>> puzzle;
-    int x_blank, y_blank;   // Coordinates of the blank tile.
-    int g = 0, h = 0;   // g = cost expended; h = heuristic value (distance to goal);
-    PuzzleNode* parent; // Will be used to find the root node for solution tracing.
-
-    PuzzleNode(vector<vector<int>> _p, int _x, int _y, int _g, int _h, PuzzleNode* _parent = nullptr)
-        : puzzle(_p), x_blank(_x), y_blank(_y), g(_g), h(_h), parent(_parent) {}
-
-    int f = g + h;  // Estimated cost of cheapest solution.
-
-    // Overloads the > operator based on the f variable for the functionality of the queue.
-    bool operator>(const PuzzleNode &_p_) const {
-        return f > _p_.f;
-    }
-};
-
-// Functions declarations.
-void print_puzzle_prompt(vector<vector<int>>&, string&);
-vector<vector<int>> init_premade_initial_puzzle(int);
-int misplaced_tile(vector<vector<int>>);
-int manhattan_distance(vector<vector<int>>);
-void print_puzzle(vector<vector<int>>, int, int);
-void print_puzzle_path(PuzzleNode*);
-void print_summary(int, int, int);
-void print_failure();
-void general_search(vector<vector<int>>, string);
-
-int main() {
-    ios::sync_with_stdio(0);    // Fast input and output.
-
-    // These two variables will get their respective values from print_puzzle_prompt().
-    vector<vector<int>> initial_puzzle(PUZZLE_SIDE_LENGTH, vector<int>(PUZZLE_SIDE_LENGTH));
-    string puzzle_heuristic_type;
-
-    print_puzzle_prompt(initial_puzzle, puzzle_heuristic_type);
-
-    // Keeps track of how long it takes to solve the puzzle.
-    auto start = chrono::high_resolution_clock::now();
-    general_search(initial_puzzle, puzzle_heuristic_type);
-    auto end = chrono::high_resolution_clock::now();
-
-    // Converts the time from microseconds to milliseconds.
-    auto micro_duration = chrono::duration_cast<chrono::microseconds>(end - start);
-    chrono::duration<double, milli> milli_duration = micro_duration;
-    cout << "Time: " << milli_duration.count() << " milliseconds" << '\n' << '\n';
-
-    return 0;
-}
-
-void print_puzzle_prompt(vector<vector<int>> &_puzzle, string &_heuristic_type) {
-    cout << "Welcome! This is a program customized to solve an Eight Puzzle." << '\n'
-         << "To get started, please do either one of the following:" << '\n'
-         << "> Type \"1\" to choose a premade initial puzzle." << '\n' 
-         << "> Type \"2\" to create your own initial puzzle." << '\n' 
-         << "Press ENTER once you have typed your choice." << '\n';
-    int puzzle_mode;
-    cin >> puzzle_mode;
-    cout << '\n';
-
-    // Reasks the user if input was invalid.
-    while (!(puzzle_mode == 1 || puzzle_mode == 2)) {
-        cout << "Invalid input. Please try again." << '\n'
-             << "Welcome! This is a program customized to solve an Eight Puzzle." << '\n'
-             << "To get started, please do either one of the following:" << '\n'
-             << "> Type \"1\" to choose a premade initial puzzle." << '\n' 
-             << "> Type \"2\" to create your own initial puzzle." << '\n' 
-             << "Press ENTER once you have typed your choice." << '\n';
-        cin >> puzzle_mode;
-        cout << '\n';
-    }
-    
-    switch(puzzle_mode) {
-        case 1:
-            cout << "You have chosen to use a premade initial puzzle." << '\n'
-                 << "Please type in an integer from 0 to 9." << '\n'
-                 << "The number inputted will determine the DIFFICULTY to solve the puzzle." << '\n'
-                 << "Press ENTER once you have typed your choice." << '\n';
-            int puzzle_difficulty;
-            cin >> puzzle_difficulty;
-            cout << '\n';
-
-            // Reasks the user if input was invalid.
-            while (!(puzzle_difficulty >= 0 && puzzle_difficulty <= 9)) {
-                cout << "Invalid input. Please try again." << '\n'
-                     << "You have chosen to use a premade initial puzzle." << '\n'
-                     << "Please type in an integer from 0 to 9." << '\n'
-                     << "The number inputted will determine the DIFFICULTY to solve the puzzle." << '\n'
-                     << "Press ENTER once you have typed your choice." << '\n';
-                cin >> puzzle_difficulty;
-                cout << '\n';
-            }
-
-            _puzzle = init_premade_initial_puzzle(puzzle_difficulty);
-            break;
-        case 2:
-            cout << "You have chosen to create your own initial puzzle." << '\n'
-                 << "Enter your puzzle, separating each number with a space in between." << '\n'
-                 << "The blank tile should be represented with \"0\"." << '\n'
-                 << "Please ensure that your puzzle is a legit 8-puzzle." << '\n'
-                 << "Press ENTER when you finish. " << '\n' << '\n';
-            
-            for (int i = 0; i < PUZZLE_SIDE_LENGTH; i++) {  // Row and column size depends on PUZZLE_SIDE_LENGTH.
-                cout << "Enter the numbers for row " << i+1 << ": ";
-                for (int j = 0; j < PUZZLE_SIDE_LENGTH; j++) {
-                    cin >> _puzzle[i][j];
-                }
-            }
-            cout << '\n';
-            break;
-        default:
-            break;  // Invalid input.
-    }
-
-    cout << "Please select an ALGORITHM by typing the number corresponding to the following: " << '\n'
-         << "\"1\" for Uniform Cost Search" << '\n'
-         << "\"2\" for Misplaced Tile Heuristic" << '\n'
-         << "\"3\" for Manhattan Distance Heuristic" << '\n';
-    int algorithm_type;
-    cin >> algorithm_type;
-    cout << '\n';
-
-    // Reasks the user if input was invalid.
-    while (!(algorithm_type == 1 || algorithm_type == 2 || algorithm_type == 3)) {
-        cout << "Invalid input. Please try again." << '\n'
-             << "Please select an ALGORITHM by typing the number corresponding to the following: " << '\n'
-             << "\"1\" for Uniform Cost Search" << '\n'
-             << "\"2\" for A* Misplaced Tile Heuristic" << '\n'
-             << "\"3\" for A* Manhattan Distance Heuristic" << '\n';
-        cin >> algorithm_type;
-        cout << '\n';
-    }
-
-    switch (algorithm_type) {
-        case 1:
-            _heuristic_type = "Uniform Cost Search";
-            break;
-        case 2:
-            _heuristic_type = "A* Misplaced";
-            break;
-        case 3:
-            _heuristic_type = "A* Manhattan";
-            break;
-        default:
-            break;  // Invalid input.
-    }
-    return;
-}
-
-vector<vector<int>> init_premade_initial_puzzle(int _difficulty) {  // Premade puzzles for testing algorithm.
-    switch(_difficulty) {
-        case 0:
-            return {{1, 2, 3},  // Depth 0
-                    {4, 5, 6},
-                    {7, 8, 0}};
-            break;
-        case 1:
-            return {{1, 2, 3},  // Depth 1
-                    {4, 5, 0},
-                    {7, 8, 6}}; 
-            ;
-        case 2:
-            return {{1, 0, 3},  // Depth 3
-                    {4, 2, 6},
-                    {7, 5, 8}};
-            break;
-        case 3:
-            return {{2, 3, 0},  // Depth 6
-                    {1, 4, 5},
-                    {7, 8, 6}};
-            break;
-        case 4:
-            return {{1, 2, 3},  // Depth 9
-                    {0, 5, 7},
-                    {4, 8, 6}};
-            break;
-        case 5:
-            return {{1, 2, 4},  // Depth 12
-                    {7, 5, 3},
-                    {0, 8, 6}};
-            break;
-        case 6:
-            return {{7, 4, 3},  // Depth 15
-                    {0, 2, 1},
-                    {8, 5, 6}};
-            break;
-        case 7:
-            return {{0, 6, 3},  // Depth 18
-                    {1, 2, 7},
-                    {5, 4, 8}};
-            break;
-        case 8:
-            return {{8, 2, 6},  // Depth 21
-                    {1, 7, 0},
-                    {5, 4, 3}};
-            break;
-        case 9:
-            return {{4, 6, 0},  // Depth 24
-                    {1, 5, 8},
-                    {7, 2, 3}};
-            break;
-        default:
-            return {{1, 2, 3},  // Invalid input.
-                    {4, 5, 6},
-                    {7, 8, 0}};
-            break;
-    }
-}
-
-int misplaced_tile(vector<vector<int>> _p) {
-    int dist = 0;
-    for (int i = 0; i < PUZZLE_SIDE_LENGTH; i++) {
-        for (int j = 0; j < PUZZLE_SIDE_LENGTH; j++) {
-            if (_p[i][j] == 0) {
-                continue; // Skips the blank tile.
-            }
-            if (_p[i][j] != PUZZLE_GOAL[i][j]) {
-                dist++;
-            }
-        }
-    }
-    return dist;
-}
-
-int manhattan_distance(vector<vector<int>> _p) {
-    int dist = 0;
-    for (int i = 0; i < PUZZLE_SIDE_LENGTH; i++) {
-        for (int j = 0; j < PUZZLE_SIDE_LENGTH; j++) {
-            if (_p[i][j] == 0) {
-                continue; // Skips the blank tile.
-            }
-            for (int x = 0; x < PUZZLE_SIDE_LENGTH; x++) {
-                for (int y = 0; y < PUZZLE_SIDE_LENGTH; y++) {
-                    if (_p[i][j] == PUZZLE_GOAL[x][y]) {
-                        dist += abs(i-x) + abs(j-y);    // Distance between matching tiles (can't be negative).
-                    }
-                }
-            }
-        }
-    }
-    return dist;
-}
-
-void print_puzzle(vector<vector<int>> _p, int _g, int _h) {
-    cout << "The best node to expand with a g(n) = " << _g << " and h(n) = " << _h << " is:" << '\n';
-    for (int i = 0; i < PUZZLE_SIDE_LENGTH; i++) {
-        cout << "[";    
-        for (int j = 0; j < PUZZLE_SIDE_LENGTH; j++) {
-            cout << _p[i][j];
-            if (j < PUZZLE_SIDE_LENGTH-1) {
-                cout << ", ";
-            }
-        }
-        cout << "]" << '\n';
-    }
-}
-
-void print_puzzle_path(PuzzleNode* _goal) {
-    vector<PuzzleNode*> puzzle_path;
-    PuzzleNode* curr = _goal;
-
-    while (curr != nullptr) {   // Traces back to root node.
-        puzzle_path.push_back(curr);
-        curr = curr->parent;
-    }
-    
-    // Makes the path start with the root and end with the goal.
-    reverse(puzzle_path.begin(), puzzle_path.end());
-
-    for (PuzzleNode* node : puzzle_path) {
-        print_puzzle(node->puzzle, node->g, node->h);
-    }
-}
-
-void print_summary(int _g, int _n, int _s) {
-    cout << "Goal state!" << '\n' << '\n'
-         << "Solution depth was " << _g << '\n'
-         << "Number of nodes expanded: " << _n << '\n'
-         << "Max queue size: " << _s << '\n' << '\n';
-}
-
-void print_failure() {
-    cout << "Unfortunately, your puzzle is impossible to solve." << '\n' << '\n';
-}
-
-void general_search(vector<vector<int>> problem, string heuristic_type) {
-    int x_blank, y_blank;   // Coordinates for the blank tile.
-    for (int i = 0; i < PUZZLE_SIDE_LENGTH; i++) {  // Locate the blank tile.
-        for (int j = 0; j < PUZZLE_SIDE_LENGTH; j++) {
-            if (problem[i][j] == 0) {
-                x_blank = i;
-                y_blank = j;
-                break;
-            }
-        }
-    }
-
-    // Set heuristic type for root_node (original problem/puzzle).
-    int heuristic = (heuristic_type == "A* Manhattan") ? manhattan_distance(problem)
-                  : (heuristic_type == "A* Misplaced") ? misplaced_tile(problem)
-                  : 0;  // Uniform Cost Search has a heuristic value of 0.
-    
-    // Creates a queue that prioritizes SMALLER costs of cheapest solutions first for the puzzle's nodes.
-    priority_queue<PuzzleNode, vector<PuzzleNode>, greater<PuzzleNode>> q;
-    PuzzleNode root_node = PuzzleNode(problem, x_blank, y_blank, 0, heuristic, nullptr);
-    q.push(root_node);
-
-    // Remembers visited puzzle nodes as keys and booleans as values.
-    map<vector<vector<int>>, bool> puzzle_visits;
-
-    const vector<int> move_x = {-1, 1, 0, 0};  // "Up" and "Down" moves.
-    const vector<int> move_y = {0, 0, -1, 1};  // "Left" and "Right" moves.
-
-    int nodes_expanded = 0, q_max_size = 1;
-    while (!q.empty()) {
-        q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
-
-        PuzzleNode curr = q.top();
-        q.pop();
-        nodes_expanded++;
-
-        if (puzzle_visits[curr.puzzle]) {   // Skip already visited nodes.
-            continue;
-        }
-        puzzle_visits[curr.puzzle] = true;  // Remembers this node.
-
-        if (curr.puzzle == PUZZLE_GOAL) {   // Successful search.
-            print_puzzle_path(&curr);
-            print_summary(curr.g, nodes_expanded, q_max_size);
-            return;
-        }
-
-        for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
-            int new_x_blank = curr.x_blank + move_x[m];
-            int new_y_blank = curr.y_blank + move_y[m];
-            
-            if (new_x_blank < 0 || new_x_blank >= PUZZLE_SIDE_LENGTH || new_y_blank < 0 || new_y_blank >= PUZZLE_SIDE_LENGTH) {
-                continue;   // Ignore tiles that are out-of-bounds.
-            }
-
-            vector<vector<int>> new_puzzle = curr.puzzle;
-            swap(new_puzzle[curr.x_blank][curr.y_blank], new_puzzle[new_x_blank][new_y_blank]);
-
-            // Makes sure new_puzzle has matching heuristic type.
-            heuristic = (heuristic_type == "A* Manhattan") ? manhattan_distance(new_puzzle)
-                      : (heuristic_type == "A* Misplaced") ? misplaced_tile(new_puzzle)
-                      : 0;  // Uniform Cost Search has a heuristic value of 0.
-            
-            q.push(PuzzleNode(new_puzzle, new_x_blank, new_y_blank, curr.g+1, heuristic, new PuzzleNode(curr)));
-        }
-    }
-    print_failure();    // Unsuccessful search.
-    return;
-}
\ No newline at end of file
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <queue>
+#include <map>
+#include <set>
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <sstream>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <unordered_set>
+#include <unordered_map>
+#include <iomanip>
+#include <array>
+#include <memory>
+#include <functional>
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+using namespace std;
+
+// Board shape, rows by columns; 3x3 is the eight puzzle. Other shapes are picked when compiling, e.g.
+// -DBOARD_ROWS=3 -DBOARD_COLS=4 for the 3x4 puzzle or -DBOARD_ROWS=4 -DBOARD_COLS=4 for the fifteen puzzle.
+#ifndef BOARD_ROWS
+#define BOARD_ROWS 3
+#endif
+#ifndef BOARD_COLS
+#define BOARD_COLS 3
+#endif
+const int PUZZLE_ROWS = BOARD_ROWS;
+const int PUZZLE_COLS = BOARD_COLS;
+const int PUZZLE_TILES = PUZZLE_ROWS * PUZZLE_COLS;
+const int32_t PUZZLE_SHAPE = PUZZLE_ROWS == PUZZLE_COLS ? PUZZLE_ROWS : PUZZLE_ROWS * 256 + PUZZLE_COLS;  // As files store it.
+
+// Per-shape tables, computed at compile time. Cells are numbered row by row and the moves are the blank's
+// up, down, left and right, so the reverse of move m is m^1. The goal is 1, 2, ... row by row with the
+// blank last, so tile t belongs in cell t-1.
+template <int ROWS, int COLS>
+struct BoardShape {
+    static_assert(ROWS >= 2 && COLS >= 2 && ROWS <= 10 && COLS <= 10, "Boards run from 2x2 to 10x10.");
+    static constexpr int TILES = ROWS * COLS;
+    static constexpr int move_x[4] = {-1, 1, 0, 0}, move_y[4] = {0, 0, -1, 1};    // Row and column step of each move.
+
+    int8_t neighbour[TILES][4];     // Cell the blank reaches from each cell with each move, -1 off the board.
+    int8_t manhattan[TILES][TILES]; // [tile][cell]: moves tile needs from cell to its goal cell, 0 for the blank.
+
+    constexpr BoardShape() : neighbour(), manhattan() {
+        for (int cell = 0; cell < TILES; cell++) {
+            for (int m = 0; m < 4; m++) {
+                int x = cell / COLS + move_x[m], y = cell % COLS + move_y[m];
+                neighbour[cell][m] = (x >= 0 && x < ROWS && y >= 0 && y < COLS) ? x * COLS + y : -1;
+            }
+            for (int tile = 1; tile < TILES; tile++) {
+                int goal = tile - 1;
+                manhattan[tile][cell] = (cell / COLS > goal / COLS ? cell / COLS - goal / COLS : goal / COLS - cell / COLS)
+                                      + (cell % COLS > goal % COLS ? cell % COLS - goal % COLS : goal % COLS - cell % COLS);
+            }
+        }
+    }
+
+    // Whether the tiles (row by row, 0 the blank) can reach the goal. A horizontal move keeps the order of
+    // the tiles; a vertical one moves a tile past COLS-1 others. With an odd width the inversion count
+    // therefore keeps its parity and must be even. With an even width each vertical move flips it and
+    // changes the blank's row by one, so inversions plus the blank's row keep the goal's parity, ROWS-1.
+    static bool solvable(const uint8_t* _tiles) {
+        int inversions = 0, blank_row = 0;
+        for (int i = 0; i < TILES; i++) {
+            if (_tiles[i] == 0) {
+                blank_row = i / COLS;
+                continue;
+            }
+            for (int j = i+1; j < TILES; j++) {
+                inversions += _tiles[j] != 0 && _tiles[j] < _tiles[i];
+            }
+        }
+        if (COLS % 2 == 1) {
+            return inversions % 2 == 0;
+        }
+        return (inversions + blank_row) % 2 == (ROWS - 1) % 2;
+    }
+};
+
+// Common shapes, instantiated and checked in every build whichever shape is compiled in.
+template struct BoardShape<2, 4>;
+template struct BoardShape<3, 3>;
+template struct BoardShape<3, 4>;
+template struct BoardShape<4, 4>;
+template struct BoardShape<4, 5>;
+static_assert(BoardShape<2, 4>().neighbour[3][1] == 7 && BoardShape<2, 4>().neighbour[3][3] == -1, "2x4 moves");
+static_assert(BoardShape<3, 4>().manhattan[1][11] == 5 && BoardShape<3, 4>().manhattan[11][0] == 4, "3x4 distances");
+static_assert(BoardShape<4, 5>().neighbour[19][0] == 14 && BoardShape<4, 5>().manhattan[19][0] == 6, "4x5 tables");
+
+constexpr BoardShape<PUZZLE_ROWS, PUZZLE_COLS> BOARD;   // Tables for the shape compiled in.
+
+// Goal state, 0 is the blank tile: 1, 2, ... row by row with the blank in the bottom right corner.
+const vector<vector<int>> PUZZLE_GOAL = []() {
+    vector<vector<int>> goal(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        goal[i / PUZZLE_COLS][i % PUZZLE_COLS] = (i + 1) % PUZZLE_TILES;
+    }
+    return goal;
+}();
+
+struct PuzzleNode {
+    vector<vector<int>> puzzle;
+    int x_blank, y_blank;   // Coordinates of the blank tile.
+    int g = 0, h = 0;   // g = cost expended; h = heuristic value (distance to goal);
+    PuzzleNode* parent; // Will be used to find the root node for solution tracing.
+
+    PuzzleNode(vector<vector<int>> _p, int _x, int _y, int _g, int _h, PuzzleNode* _parent = nullptr)
+        : puzzle(_p), x_blank(_x), y_blank(_y), g(_g), h(_h), parent(_parent) {}
+
+    double f = g + h;   // Estimated cost of cheapest solution (g + w*h for the weighted modes).
+    int move = -1;      // Index of the blank's move that made this node, -1 if unknown (e.g. the root).
+
+    // Overloads the > operator based on the f variable for the functionality of the queue.
+    bool operator>(const PuzzleNode &_p_) const {
+        return f > _p_.f;
+    }
+};
+
+// A priority queue of puzzle nodes whose underlying heap can be saved and restored exactly, so a
+// resumed search pops nodes in the same order (including ties) as the original one would have.
+struct PuzzleQueue : priority_queue<PuzzleNode, vector<PuzzleNode>, greater<PuzzleNode>> {
+    vector<PuzzleNode>& heap() {
+        return c;
+    }
+};
+
+// Tunable settings for the search modes that need more than a heuristic type.
+struct SearchOptions {
+    double weight = 1.0;    // w in f = g + w*h; 1.0 is plain A*. Solutions are at most w times optimal.
+    double weight_step = 0.5;   // How much the anytime search lowers w after each solution.
+    double time_budget_ms = 1000.0;  // How long the anytime search keeps tightening its solution.
+    double deadline_ms = 0;     // Wall-clock limit for any search mode; 0 means no limit.
+    long long max_nodes = 0;    // Limit on nodes expanded for any search mode; 0 means no limit.
+    atomic<bool>* cancel_token = nullptr;   // Set to true from another thread or a signal to stop the search.
+    string checkpoint_path;     // Where to save snapshots of the search; empty means no checkpoints.
+    double checkpoint_every_ms = 0;     // Time between periodic snapshots; 0 means only on request.
+    atomic<bool>* checkpoint_token = nullptr;   // Set to true (e.g. by SIGUSR1) to request a snapshot.
+    string resume_path;         // Snapshot to resume the search from instead of starting over.
+    bool verbose = true;        // Prints the solution path and summary; turned off when solving for the server.
+    long long transposition_entries = 1 << 16;  // Slots in the depth-first modes' transposition table; 0 disables it.
+    bool move_pruning = true;   // Whether depth-first modes skip move sequences the pruning automaton rejects.
+    int perimeter_depth = 10;   // Radius of the goal neighbourhood stored for perimeter search.
+    vector<vector<int>> goal;   // Goal for this query; empty means PUZZLE_GOAL.
+    int beam_width = 64;        // Nodes kept per layer by beam search.
+    int lookahead = 3;          // Depth of LRTA*'s search before each move it commits to.
+    int trials = 1;             // How many times LRTA* solves the query, learning from the earlier runs.
+    long long learned_limit = 1 << 20;  // Learned heuristic values LRTA* keeps before starting over; 0 means no limit.
+    string trace_path;          // Where to record every expansion; empty means no tracing.
+    int projection_depth = 0;   // Depth to project the memory requirement to after a solve; 0 means none.
+    bool print_layers = false;  // Prints the expansions per depth and f layer after a solve.
+    bool generation_checks = false;     // Whether general_search prunes duplicates and finds the goal as children are made.
+};
+
+// Maps queries for another goal onto PUZZLE_GOAL so every table built for it can be reused. First one of
+// the board's 8 symmetries (rotations and reflections; 4 if it is not square) moves the goal's blank onto PUZZLE_GOAL's blank,
+// then the tiles are renamed so the transformed goal reads exactly like PUZZLE_GOAL. Moves map through the
+// same symmetry, so an optimal solution of the mapped query is an optimal solution of the original one.
+// Symmetries only move corners to corners, so the goal's blank has to be in a corner.
+struct GoalMapping {
+    int symmetry = 0;
+    vector<int> relabel;    // Tile in the transformed goal -> tile of PUZZLE_GOAL at the same position.
+};
+
+// Memory held by a search's own data structures at their largest, in bytes, counted from the structures
+// themselves. Modes that do not track a part leave it 0.
+struct MemoryUsage {
+    size_t frontier_bytes = 0, closed_bytes = 0, arena_bytes = 0;
+    size_t stored_nodes = 0;        // Distinct boards the search kept; the arena counts only in bytes.
+    size_t heuristic_bytes = 0;     // Pattern database or perimeter tables, shared by every solve, so not per node.
+    double closed_load_factor = 0;  // Only for hash-based closed sets.
+    bool bounded = false;           // Depth-first: everything but the path is allocated up front.
+};
+
+// Expansions counted per depth (g) and per f layer. The best-first modes file each expansion under its
+// unweighted f; IDA* files it under the iteration's threshold, so there each f layer is one iteration.
+struct LayerStats {
+    vector<long long> by_depth, by_f;
+
+    void record(int _g, int _f) {
+        if (_g >= (int)by_depth.size()) {
+            by_depth.resize(_g + 1, 0);
+        }
+        if (_f >= (int)by_f.size()) {
+            by_f.resize(_f + 1, 0);
+        }
+        by_depth[_g]++;
+        by_f[_f]++;
+    }
+
+    // Geometric mean growth from one nonempty f layer to the next. The last layer is left out since the
+    // search stops partway through it; 0 when fewer than two complete layers remain.
+    double layer_growth() const {
+        vector<int> layers;
+        for (int f = 0; f < (int)by_f.size(); f++) {
+            if (by_f[f] > 0) {
+                layers.push_back(f);
+            }
+        }
+        if (layers.size() < 3) {
+            return 0;
+        }
+        return pow((double)by_f[layers.end()[-2]] / by_f[layers[0]], 1.0 / (layers.size() - 2));
+    }
+};
+
+// What a search mode reports back, whether it finished or was stopped early.
+struct SearchResult {
+    bool solved = false;
+    string stop_reason;     // Empty unless stopped early: "deadline", "node budget", "node store full" or "cancelled".
+    int depth = -1;         // Solution depth, or -1 if no solution was found.
+    int lower_bound = 0;    // Best proven lower bound on the optimal depth so far.
+    int nodes_expanded = 0, q_max_size = 0;
+    int nodes_reopened = 0;     // Expanded again after a cheaper path was found (inconsistent heuristics).
+    string moves;           // Moves of the blank tile from the start to the goal: U, D, L or R.
+    MemoryUsage memory;
+    LayerStats layers;      // Only the A*, compact A* and IDA* modes count them.
+};
+
+// Checks the deadline, node budget and cancellation token. The clock and the token are only
+// consulted every CHECK_INTERVAL expansions, so the check costs almost nothing per node.
+struct SearchLimits {
+    static const int CHECK_INTERVAL = 1024;
+    SearchOptions options;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    string stop_reason;
+
+    chrono::steady_clock::time_point last_checkpoint = start;
+
+    SearchLimits(SearchOptions _options) : options(_options) {}
+
+    // Checked at the same interval as should_stop(); true when a snapshot is due or was requested.
+    bool should_checkpoint(long long _nodes_expanded) {
+        if (options.checkpoint_path.empty() || _nodes_expanded % CHECK_INTERVAL != 0) {
+            return false;
+        }
+        bool requested = options.checkpoint_token != nullptr && options.checkpoint_token->exchange(false);
+        chrono::duration<double, milli> since_last = chrono::steady_clock::now() - last_checkpoint;
+        if (requested || (options.checkpoint_every_ms > 0 && since_last.count() >= options.checkpoint_every_ms)) {
+            last_checkpoint = chrono::steady_clock::now();
+            return true;
+        }
+        return false;
+    }
+
+    bool should_stop(long long _nodes_expanded) {
+        if (options.max_nodes > 0 && _nodes_expanded >= options.max_nodes) {
+            stop_reason = "node budget";
+        } else if (_nodes_expanded % CHECK_INTERVAL != 0) {
+            return false;
+        } else if (options.cancel_token != nullptr && options.cancel_token->load(memory_order_relaxed)) {
+            stop_reason = "cancelled";
+        } else if (options.deadline_ms > 0 && elapsed_ms() >= options.deadline_ms) {
+            stop_reason = "deadline";
+        }
+        return !stop_reason.empty();
+    }
+
+    double elapsed_ms() {
+        chrono::duration<double, milli> d = chrono::steady_clock::now() - start;
+        return d.count();
+    }
+};
+
+// Node storage for compact_search as a structure of arrays: node i is boards[i], parents[i], blanks[i] and
+// gs[i]. The queue only holds 8-byte keys that point into it.
+struct CompactNodeStore {
+    vector<uint64_t> boards;
+    vector<uint32_t> parents;   // Index of the parent node; the root points to itself.
+    vector<uint8_t> blanks;     // Blank position in row-major order.
+    vector<uint8_t> gs;
+
+    // Node indexes are 32 bits wide, so searches stop before an expansion could add a node past this.
+    static const uint64_t MAX_NODES = UINT32_MAX;
+
+    bool full() const {
+        return boards.size() + 4 > MAX_NODES;
+    }
+
+    uint32_t add(uint64_t _board, uint32_t _parent, int _blank, int _g) {
+        boards.push_back(_board);
+        parents.push_back(_parent);
+        blanks.push_back(_blank);
+        gs.push_back(_g);
+        return boards.size() - 1;
+    }
+
+    size_t memory_bytes() const {
+        return boards.capacity() * sizeof(uint64_t) + parents.capacity() * sizeof(uint32_t) + blanks.capacity() + gs.capacity();
+    }
+
+    // Forgets every node but keeps the memory, so the next search allocates nothing until it outgrows it.
+    void rewind() {
+        boards.clear();
+        parents.clear();
+        blanks.clear();
+        gs.clear();
+    }
+};
+
+// Open-addressing set of packed boards. Each slot is stamped with the generation that filled it, so
+// clearing the set only bumps the generation instead of touching every slot.
+struct StampedClosedSet {
+    vector<uint64_t> boards;
+    vector<uint32_t> stamps;
+    uint32_t generation = 1;
+    size_t count = 0;
+
+    bool contains(uint64_t _board) {
+        if (count == 0) {
+            return false;
+        }
+        size_t mask = boards.size() - 1;
+        for (size_t i = (_board * 0x9e3779b97f4a7c15ULL) >> 20 & mask; stamps[i] == generation; i = (i + 1) & mask) {
+            if (boards[i] == _board) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns true if the board was not in the set yet.
+    bool insert(uint64_t _board) {
+        if ((count + 1) * 2 > boards.size()) {
+            grow();
+        }
+        size_t mask = boards.size() - 1;
+        for (size_t i = (_board * 0x9e3779b97f4a7c15ULL) >> 20 & mask; ; i = (i + 1) & mask) {
+            if (stamps[i] != generation) {
+                boards[i] = _board;
+                stamps[i] = generation;
+                count++;
+                return true;
+            }
+            if (boards[i] == _board) {
+                return false;
+            }
+        }
+    }
+
+    size_t memory_bytes() const {
+        return boards.capacity() * sizeof(uint64_t) + stamps.capacity() * sizeof(uint32_t);
+    }
+
+    double load_factor() const {
+        return boards.empty() ? 0 : (double)count / boards.size();
+    }
+
+    void clear() {
+        count = 0;
+        if (++generation == 0) {    // The stamps wrapped around; old ones could look current again.
+            fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+    }
+
+    void grow() {   // Doubles the table and re-inserts the current generation's boards.
+        vector<uint64_t> old_boards = move(boards);
+        vector<uint32_t> old_stamps = move(stamps);
+        boards.assign(max((size_t)1024, old_boards.size() * 2), 0);
+        stamps.assign(boards.size(), 0);
+        count = 0;
+        for (size_t i = 0; i < old_boards.size(); i++) {
+            if (old_stamps[i] == generation) {
+                insert(old_boards[i]);
+            }
+        }
+    }
+};
+
+// Hashes for StampedMap's keys: packed boards and puzzle grids.
+uint64_t stamped_hash(uint64_t _board) {
+    return _board * 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t stamped_hash(const vector<vector<int>> &_puzzle) {
+    uint64_t hash = 0;
+    for (const vector<int> &row : _puzzle) {
+        for (int tile : row) {
+            hash = (hash ^ tile) * 0x100000001b3ULL;
+        }
+    }
+    return hash * 0x9e3779b97f4a7c15ULL;
+}
+
+// Open-addressing map stamped by generation like StampedClosedSet, for closed sets that need a value per
+// board or are keyed by puzzle grids. A slot keeps its key after clear(), so a grid copied into it later
+// reuses the rows that are already allocated.
+template <typename Key, typename Value>
+struct StampedMap {
+    vector<Key> keys;
+    vector<Value> values;
+    vector<uint32_t> stamps;
+    uint32_t generation = 1;
+    size_t count = 0;
+
+    Value* find(const Key &_key) {
+        if (count == 0) {
+            return nullptr;
+        }
+        size_t mask = keys.size() - 1;
+        for (size_t i = stamped_hash(_key) >> 20 & mask; stamps[i] == generation; i = (i + 1) & mask) {
+            if (keys[i] == _key) {
+                return &values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Like map::emplace: the key's value, and whether the key was inserted with `_value` just now.
+    pair<Value*, bool> emplace(const Key &_key, const Value &_value) {
+        if ((count + 1) * 2 > keys.size()) {
+            grow();
+        }
+        size_t mask = keys.size() - 1;
+        for (size_t i = stamped_hash(_key) >> 20 & mask; ; i = (i + 1) & mask) {
+            if (stamps[i] != generation) {
+                keys[i] = _key;
+                values[i] = _value;
+                stamps[i] = generation;
+                count++;
+                return {&values[i], true};
+            }
+            if (keys[i] == _key) {
+                return {&values[i], false};
+            }
+        }
+    }
+
+    Value& operator[](const Key &_key) {
+        return *emplace(_key, Value()).first;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    template <typename Visit>
+    void for_each(Visit _visit) const {
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (stamps[i] == generation) {
+                _visit(keys[i], values[i]);
+            }
+        }
+    }
+
+    template <typename Visit>
+    void for_each(Visit _visit) {   // Lets `_visit` change the values.
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (stamps[i] == generation) {
+                _visit((const Key&)keys[i], values[i]);
+            }
+        }
+    }
+
+    double load_factor() const {
+        return keys.empty() ? 0 : (double)count / keys.size();
+    }
+
+    // Bytes held by the slots, which keep their capacity from earlier solves; `_key_heap_bytes` is what one
+    // key owns outside the slot, such as a grid's rows.
+    size_t memory_bytes(size_t _key_heap_bytes = 0) const {
+        return keys.size() * (sizeof(Key) + _key_heap_bytes + sizeof(Value) + sizeof(uint32_t));
+    }
+
+    void clear() {
+        count = 0;
+        if (++generation == 0) {    // The stamps wrapped around; old ones could look current again.
+            fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+    }
+
+    void grow() {   // Doubles the table and moves the current generation's entries over.
+        vector<Key> old_keys = move(keys);
+        vector<Value> old_values = move(values);
+        vector<uint32_t> old_stamps = move(stamps);
+        keys.assign(max((size_t)1024, old_keys.size() * 2), Key());
+        values.assign(keys.size(), Value());
+        stamps.assign(keys.size(), 0);
+        size_t mask = keys.size() - 1;
+        for (size_t j = 0; j < old_keys.size(); j++) {
+            if (old_stamps[j] != generation) {
+                continue;
+            }
+            size_t i = stamped_hash(old_keys[j]) >> 20 & mask;
+            while (stamps[i] == generation) {
+                i = (i + 1) & mask;
+            }
+            keys[i] = move(old_keys[j]);
+            values[i] = move(old_values[j]);
+            stamps[i] = generation;
+        }
+    }
+};
+
+// Parent copies made by the modes built on PuzzleNode. Nodes never move, so children can point at them,
+// and rewind() keeps every slot: the next search's copies overwrite the grids in place.
+struct PuzzleNodeArena {
+    deque<PuzzleNode> slots;
+    size_t used = 0;
+
+    PuzzleNode* add(const PuzzleNode &_node) {
+        if (used == slots.size()) {
+            slots.push_back(_node);
+        } else {
+            slots[used] = _node;
+        }
+        return &slots[used++];
+    }
+
+    void drop_last() {  // Takes back the last add(); its slot is reused by the next one.
+        used--;
+    }
+
+    size_t size() const {
+        return used;
+    }
+
+    size_t memory_bytes(size_t _puzzle_bytes) const {
+        return slots.size() * (sizeof(PuzzleNode) + _puzzle_bytes);
+    }
+
+    void rewind() {
+        used = 0;
+    }
+};
+
+// Fringe search's cache entry, one per visited puzzle; prev/next link the entries currently in the fringe.
+struct FringeEntry {
+    uint64_t board;
+    int g, h, blank;
+    int32_t parent, prev, next;
+    bool in_fringe;
+};
+
+// Fixed-size transposition table for depth-first search. Each slot remembers one board, the smallest g it
+// was reached with and the IDA* threshold of that pass. When two boards collide, the one with more search
+// budget left (the smaller g) keeps the slot, and slots from earlier passes are always replaced. Slots are
+// stamped with the generation that filled them, so clear() forgets a whole solve without touching them.
+struct TranspositionTable {
+    struct Entry {
+        uint64_t board = 0;
+        uint32_t generation = 0;
+        int16_t threshold = 0;
+        int16_t g = 0;
+    };
+    vector<Entry> entries;
+    uint64_t mask = 0;
+    uint32_t generation = 1;
+
+    // Sizes the table to the largest power of two up to `_entries`, keeping it if it already has that size.
+    void resize(long long _entries) {
+        size_t size = 0;
+        while (_entries > 0 && (long long)max((size_t)1, size * 2) <= _entries) {
+            size = max((size_t)1, size * 2);
+        }
+        if (size != entries.size()) {
+            entries.assign(size, Entry());
+            mask = size - 1;
+            generation = 1;
+        }
+    }
+
+    Entry& slot(uint64_t _board) {
+        return entries[(_board * 0x9e3779b97f4a7c15ULL >> 20) & mask];
+    }
+
+    size_t used() const {
+        return count_if(entries.begin(), entries.end(), [&](const Entry &_entry) { return _entry.generation == generation; });
+    }
+
+    // True if the board was already searched this pass with at least as much budget; otherwise records it.
+    bool seen_or_store(uint64_t _board, int _g, int _threshold) {
+        if (entries.empty()) {
+            return false;
+        }
+        Entry &entry = slot(_board);
+        bool current = entry.generation == generation && entry.threshold == _threshold;
+        if (current && entry.board == _board && entry.g <= _g) {
+            return true;
+        }
+        if (!current || _g <= entry.g) {
+            entry = {_board, generation, (int16_t)_threshold, (int16_t)_g};
+        }
+        return false;
+    }
+
+    void clear() {
+        if (++generation == 0) {    // The stamps wrapped around; old ones could look current again.
+            fill(entries.begin(), entries.end(), Entry());
+            generation = 1;
+        }
+    }
+};
+
+// Anytime search's latest node for a puzzle, and whether it waits in the queue or in the inconsistent list.
+// A puzzle that does neither keeps its entry with `list` set to NONE, since StampedMap has no erase.
+struct AnytimeEntry {
+    enum List : uint8_t { NONE, OPEN, INCONS };
+    PuzzleNode* node = nullptr;     // In the context's arena.
+    List list = NONE;
+};
+
+// Reusable solver state: the frontiers, closed sets and node arenas survive between solves, and reset()
+// rewinds them by generation, so a long-lived context runs many small solves without going back to the
+// allocator. The packed-board modes use the first group, the modes built on PuzzleNode the second.
+struct SearchContext {
+    CompactNodeStore nodes;
+    vector<uint64_t> frontier;  // Binary min-heap of compact keys.
+    StampedClosedSet closed;
+    vector<FringeEntry> fringe;     // Fringe search's cache, indexed through fringe_index.
+    StampedMap<uint64_t, int32_t> fringe_index;
+    TranspositionTable table;       // IDA*'s; sized by each solve's options.
+
+    PuzzleQueue queue;
+    StampedMap<vector<vector<int>>, int> puzzle_g;  // g per puzzle; what it means is up to the mode.
+    StampedMap<vector<vector<int>>, uint8_t> closed_puzzles;    // Anytime search's closed set for the current pass.
+    StampedMap<vector<vector<int>>, AnytimeEntry> anytime_nodes;    // Anytime search's open and inconsistent puzzles.
+    vector<PuzzleNode*> anytime_queue;      // Anytime search's min-heap on f, of nodes in the arena.
+    PuzzleNodeArena parents;
+
+    unordered_map<uint64_t, int> learned_h;     // LRTA*'s learned heuristic values; kept across solves up to options.learned_limit.
+
+    void reset() {
+        nodes.rewind();
+        frontier.clear();
+        closed.clear();
+        fringe.clear();
+        fringe_index.clear();
+        table.clear();
+        queue.heap().clear();
+        puzzle_g.clear();
+        closed_puzzles.clear();
+        anytime_nodes.clear();
+        anytime_queue.clear();
+        parents.rewind();
+    }
+
+    SearchResult solve(vector<vector<int>>, string, SearchOptions);
+    SearchResult dispatch(vector<vector<int>>, string, SearchOptions);
+};
+
+// One instance of a batch run.
+struct BatchJob {
+    vector<vector<int>> puzzle;
+    double estimated_cost = 0;
+    bool solvable = true;
+    SearchResult result;
+    double wait_ms = 0, run_ms = 0;     // Time spent queued since the batch started, and time spent solving.
+};
+
+// One expansion as written to a trace file, 24 bytes. Traces start with "NPZTRC1" and the shape:
+// the side length for square boards, rows * 256 + columns otherwise.
+struct TraceRecord {
+    uint64_t board;     // Packed board (see pack_puzzle), or 0 on boards of more than 16 tiles.
+    uint32_t frontier;  // Frontier size when the node was expanded, or the path length for depth-first modes.
+    uint32_t delta_ns;  // On every TIME_SAMPLE-th record of a thread, the time since the previous such record; else 0.
+    int16_t g, h, f;
+    uint8_t blank;      // Cell of the blank tile in row-major order.
+    uint8_t thread;     // Which tracing thread wrote the record.
+};
+
+// Records of one search thread on their way to the file. Only the search thread moves `head` and only the
+// flusher moves `tail`, so neither side ever waits; a record that finds the ring full is dropped and counted.
+struct TraceRing {
+    static const uint64_t CAPACITY = 1 << 18;
+    static const uint64_t TIME_SAMPLE = 32;     // Reading the clock costs more than the rest of a record.
+    vector<TraceRecord> records = vector<TraceRecord>(CAPACITY);
+    atomic<uint64_t> head{0}, tail{0};
+    atomic<uint64_t> dropped{0};
+    chrono::steady_clock::time_point last = chrono::steady_clock::now();
+    uint8_t thread = 0;
+};
+
+// Collects expansion records from every search thread and has a background thread write them out, so
+// tracing adds a clock read and a few stores per expansion to the search itself.
+struct ExpansionTracer {
+    FILE* out = nullptr;
+    mutex rings_lock;   // Only taken when a thread writes its first record, and by the flusher.
+    vector<unique_ptr<TraceRing>> rings;
+    atomic<bool> stopping{false};
+    thread flusher;
+    uint64_t written = 0;
+    uint64_t generation = 0;    // Tells this tracer's rings from those of an earlier, deleted one.
+
+    // The calling thread's ring. Threads cache it keyed by the tracer's generation rather than its address,
+    // which a later tracer could reuse.
+    TraceRing& ring() {
+        thread_local uint64_t ring_generation = 0;
+        thread_local TraceRing* ring = nullptr;
+        if (ring_generation != generation) {
+            lock_guard<mutex> guard(rings_lock);
+            rings.emplace_back(new TraceRing());
+            ring = rings.back().get();
+            ring->thread = rings.size() - 1;
+            ring_generation = generation;
+        }
+        return *ring;
+    }
+
+    void record(uint64_t _board, int _blank, int _g, int _h, int _f, size_t _frontier) {
+        TraceRing &r = ring();
+        uint64_t head = r.head.load(memory_order_relaxed);
+        if (head - r.tail.load(memory_order_acquire) >= TraceRing::CAPACITY) {
+            r.dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        long long delta_ns = 0;
+        if (head % TraceRing::TIME_SAMPLE == 0) {
+            chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            delta_ns = chrono::duration_cast<chrono::nanoseconds>(now - r.last).count();
+            r.last = now;
+        }
+        r.records[head % TraceRing::CAPACITY] = {_board, (uint32_t)min<size_t>(_frontier, UINT32_MAX),
+                                                 (uint32_t)min<long long>(delta_ns, UINT32_MAX),
+                                                 (int16_t)_g, (int16_t)_h, (int16_t)_f, (uint8_t)_blank, r.thread};
+        r.head.store(head + 1, memory_order_release);
+    }
+
+    // Writes out everything the rings hold; called by the flusher thread, and once more after it stops.
+    void flush() {
+        lock_guard<mutex> guard(rings_lock);
+        for (unique_ptr<TraceRing> &r : rings) {
+            uint64_t tail = r->tail.load(memory_order_relaxed), head = r->head.load(memory_order_acquire);
+            while (tail < head) {   // At most two runs, split where the ring wraps around.
+                uint64_t run = min(head - tail, TraceRing::CAPACITY - tail % TraceRing::CAPACITY);
+                fwrite(&r->records[tail % TraceRing::CAPACITY], sizeof(TraceRecord), run, out);
+                tail += run;
+                written += run;
+            }
+            r->tail.store(tail, memory_order_release);
+        }
+    }
+
+    bool start(string _path) {
+        out = fopen(_path.c_str(), "wb");
+        if (out == nullptr) {
+            return false;
+        }
+        int32_t shape = PUZZLE_SHAPE;
+        fwrite("NPZTRC1", 1, 7, out);
+        fwrite(&shape, sizeof(shape), 1, out);
+        static atomic<uint64_t> started(0);
+        generation = ++started;
+        flusher = thread([this]() {
+            while (!stopping.load()) {
+                this_thread::sleep_for(chrono::milliseconds(1));
+                flush();
+            }
+        });
+        return true;
+    }
+
+    // Returns how many records were dropped because a ring was full.
+    uint64_t stop() {
+        stopping.store(true);
+        flusher.join();
+        flush();
+        fclose(out);
+        uint64_t dropped = 0;
+        for (unique_ptr<TraceRing> &r : rings) {
+            dropped += r->dropped.load();
+        }
+        return dropped;
+    }
+};
+
+// Functions declarations.
+void print_puzzle_prompt(vector<vector<int>>&, string&, SearchOptions&);
+vector<vector<int>> init_premade_initial_puzzle(int);
+int misplaced_tile(const vector<vector<int>>&);
+int manhattan_distance(const vector<vector<int>>&);
+string heuristic_type_for_algorithm(int);
+int compute_heuristic(vector<vector<int>>&, string&);
+int goal_relative_heuristic(vector<vector<int>>&, const vector<vector<int>>&, string&);
+void locate_blank(vector<vector<int>>&, int&, int&);
+bool is_tile_permutation(const vector<vector<int>>&);
+void print_puzzle(vector<vector<int>>, int, int);
+void print_puzzle_path(PuzzleNode*);
+void print_summary(int, int, int);
+void print_failure();
+void print_stopped(SearchResult&);
+void reset_peak_rss();
+long peak_rss_kb();
+void print_memory_usage(SearchResult&, int);
+double nodes_up_to_depth(double, int);
+double effective_branching_factor(double, int);
+void print_layer_stats(SearchResult&);
+string trace_moves(PuzzleNode*);
+bool parse_search_flags(int, char*[], SearchOptions&);
+string serialize_search(vector<vector<int>>&, string&, double, PuzzleQueue&, StampedMap<vector<vector<int>>, int>&, int, int);
+bool load_checkpoint(string, vector<vector<int>>&, string&, double&, PuzzleQueue&, StampedMap<vector<vector<int>>, int>&, PuzzleNodeArena&, int&, int&);
+bool write_file_atomically(string, const string&);
+void write_checkpoint(pid_t&, string, const function<string()>&);
+void wait_checkpoint(pid_t&);
+bool is_ida_star_checkpoint(string);
+SearchResult general_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult anytime_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult run_search(vector<vector<int>>, string, SearchOptions);
+SearchResult partial_expansion_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult compact_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult fringe_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult ida_star_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+uint64_t pack_puzzle(const vector<vector<int>>&);
+bool packed_boards_fit();
+void lane_ida_star_batch(vector<BatchJob>&, vector<int>&, atomic<size_t>&, SearchOptions, int, chrono::steady_clock::time_point);
+SearchResult perimeter_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+int pattern_database_heuristic(vector<vector<int>>&, bool);
+size_t pattern_database_memory();
+int run_pdb_builder(int, char*[]);
+void print_pattern_database_benchmark(vector<string>, SearchOptions, SearchContext&);
+SearchResult beam_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+SearchResult lrta_star_search(vector<vector<int>>, string, SearchOptions, SearchContext&);
+bool map_goal(vector<vector<int>>&, GoalMapping&);
+vector<vector<int>> apply_goal_mapping(GoalMapping&, vector<vector<int>>&);
+bool is_solvable_for_goal(vector<vector<int>>&, vector<vector<int>>&);
+SearchResult solve_for_goal(vector<vector<int>>, string, SearchOptions, SearchContext&);
+struct LargeBoard;
+string reduction_solve(LargeBoard&, SearchContext&);
+int run_reduction(int, char*[]);
+uint32_t rank_tiles(const uint8_t*);
+void unrank_tiles(uint32_t, uint8_t*);
+const vector<uint8_t>& distance_table();
+uint64_t packed_depth_orders();
+uint64_t packed_depth_index(const uint8_t*);
+const vector<uint8_t>& packed_depth_table();
+int exact_depth(const uint8_t*);
+const vector<uint32_t>& distance_table_order(vector<uint32_t>&);
+bool is_solvable_tiles(const uint8_t*);
+int run_generator(int, char*[]);
+int run_server(int, char*[]);
+struct CdpModel;
+CdpModel sample_cdp_model(string, long long, unsigned);
+double predict_ida_star_iteration(const CdpModel&, vector<vector<int>>&, int);
+double predict_ida_star_expansions(const CdpModel&, vector<vector<int>>&, int);
+int estimate_solution_depth(vector<vector<int>>&);
+double estimate_job_cost(vector<vector<int>>&, string&, int = -1, const CdpModel* = nullptr);
+struct MovePruningAutomaton;
+const MovePruningAutomaton& move_pruning_automaton();
+int run_batch(int, char*[]);
+int run_benchmark(int, char*[]);
+int run_verification(int, char*[]);
+int run_prediction(int, char*[]);
+bool start_expansion_trace(string);
+void stop_expansion_trace();
+int run_trace_report(int, char*[]);
+
+atomic<bool> interrupt_requested(false);    // Set by SIGINT/SIGTERM so a running search can stop cleanly.
+atomic<bool> checkpoint_requested(false);   // Set by SIGUSR1 to snapshot a running search.
+string pattern_database_compression = "none";   // Storage used by the PDB heuristics; set with --pdb-compression or --pdb-blank-mod3.
+int pattern_database_block = 4;                 // Ranks per entry for "min" storage; set with --pdb-block.
+ExpansionTracer* expansion_tracer = nullptr;    // Records every expansion while --trace is on.
+
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(0);    // Fast input and output.
+
+    if (argc > 1 && string(argv[1]) == "--generate") {   // Instance generator instead of the interactive solver.
+        return run_generator(argc, argv);
+    }
+    if (argc > 1 && (string(argv[1]) == "--serve" || string(argv[1]) == "--serve-tcp")) {  // Long-lived solve service.
+        return run_server(argc, argv);
+    }
+    if (argc > 2 && string(argv[1]) == "--batch") {  // Solves every instance in a file across a worker pool.
+        return run_batch(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--benchmark") {  // Compares algorithms on the premade puzzles.
+        return run_benchmark(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--verify") {  // Checks every algorithm against an exact oracle.
+        return run_verification(argc, argv);
+    }
+    if (argc > 2 && string(argv[1]) == "--predict") {  // Predicts IDA*'s expansions without searching.
+        return run_prediction(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--build-pdb") {  // Builds and checks the pattern databases.
+        return run_pdb_builder(argc, argv);
+    }
+    if (argc > 3 && string(argv[1]) == "--reduce") {  // Fast suboptimal solver for boards of any size.
+        return run_reduction(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--trace-report") {  // Summarizes a trace written with --trace.
+        return run_trace_report(argc, argv);
+    }
+
+    // These two variables will get their respective values from print_puzzle_prompt().
+    vector<vector<int>> initial_puzzle(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    string puzzle_heuristic_type;
+    SearchOptions puzzle_options;
+    if (!parse_search_flags(argc, argv, puzzle_options)) {
+        return 1;
+    }
+
+    puzzle_options.cancel_token = &interrupt_requested;
+    puzzle_options.checkpoint_token = &checkpoint_requested;
+    signal(SIGUSR1, [](int) { checkpoint_requested.store(true); });
+    if (!puzzle_options.trace_path.empty() && !start_expansion_trace(puzzle_options.trace_path)) {
+        return 1;
+    }
+
+    // A resumed search reads its puzzle and algorithm from the checkpoint instead of asking for them.
+    if (puzzle_options.resume_path.empty()) {
+        print_puzzle_prompt(initial_puzzle, puzzle_heuristic_type, puzzle_options);
+    }
+
+    // Ctrl+C (or a SIGTERM preemption) stops the search and reports its progress instead of killing the program.
+    // Installed only now, so Ctrl+C at the prompts above still exits as usual.
+    interrupt_requested.store(false);
+    signal(SIGINT, [](int) { interrupt_requested.store(true); });
+    signal(SIGTERM, [](int) { interrupt_requested.store(true); });
+
+    // Keeps track of how long it takes to solve the puzzle.
+    auto start = chrono::high_resolution_clock::now();
+    SearchContext context;
+    reset_peak_rss();
+    SearchResult result = context.solve(initial_puzzle, puzzle_heuristic_type, puzzle_options);
+    auto end = chrono::high_resolution_clock::now();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    print_memory_usage(result, puzzle_options.projection_depth);
+    if (puzzle_options.print_layers) {
+        print_layer_stats(result);
+    }
+
+    // Converts the time from microseconds to milliseconds.
+    auto micro_duration = chrono::duration_cast<chrono::microseconds>(end - start);
+    chrono::duration<double, milli> milli_duration = micro_duration;
+    cout << "Time: " << milli_duration.count() << " milliseconds" << '\n' << '\n';
+    stop_expansion_trace();
+
+    return 0;
+}
+
+void print_puzzle_prompt(vector<vector<int>> &_puzzle, string &_heuristic_type, SearchOptions &_options) {
+    cout << "Welcome! This is a program customized to solve an Eight Puzzle." << '\n'
+         << "To get started, please do either one of the following:" << '\n'
+         << "> Type \"1\" to choose a premade initial puzzle." << '\n' 
+         << "> Type \"2\" to create your own initial puzzle." << '\n' 
+         << "Press ENTER once you have typed your choice." << '\n';
+    int puzzle_mode;
+    cin >> puzzle_mode;
+    cout << '\n';
+
+    // Reasks the user if input was invalid.
+    while (!(puzzle_mode == 1 || puzzle_mode == 2)) {
+        cout << "Invalid input. Please try again." << '\n'
+             << "Welcome! This is a program customized to solve an Eight Puzzle." << '\n'
+             << "To get started, please do either one of the following:" << '\n'
+             << "> Type \"1\" to choose a premade initial puzzle." << '\n' 
+             << "> Type \"2\" to create your own initial puzzle." << '\n' 
+             << "Press ENTER once you have typed your choice." << '\n';
+        cin >> puzzle_mode;
+        cout << '\n';
+    }
+    
+    switch(puzzle_mode) {
+        case 1:
+            cout << "You have chosen to use a premade initial puzzle." << '\n'
+                 << "Please type in an integer from 0 to 9." << '\n'
+                 << "The number inputted will determine the DIFFICULTY to solve the puzzle." << '\n'
+                 << "Press ENTER once you have typed your choice." << '\n';
+            int puzzle_difficulty;
+            cin >> puzzle_difficulty;
+            cout << '\n';
+
+            // Reasks the user if input was invalid.
+            while (!(puzzle_difficulty >= 0 && puzzle_difficulty <= 9)) {
+                cout << "Invalid input. Please try again." << '\n'
+                     << "You have chosen to use a premade initial puzzle." << '\n'
+                     << "Please type in an integer from 0 to 9." << '\n'
+                     << "The number inputted will determine the DIFFICULTY to solve the puzzle." << '\n'
+                     << "Press ENTER once you have typed your choice." << '\n';
+                cin >> puzzle_difficulty;
+                cout << '\n';
+            }
+
+            _puzzle = init_premade_initial_puzzle(puzzle_difficulty);
+            break;
+        case 2:
+            cout << "You have chosen to create your own initial puzzle." << '\n'
+                 << "Enter your puzzle, separating each number with a space in between." << '\n'
+                 << "The blank tile should be represented with \"0\"." << '\n'
+                 << "Please ensure that your puzzle is a legit 8-puzzle." << '\n'
+                 << "Press ENTER when you finish. " << '\n' << '\n';
+            
+            for (int i = 0; i < PUZZLE_ROWS; i++) {  // Row and column size depends on PUZZLE_ROWS and PUZZLE_COLS.
+                cout << "Enter the numbers for row " << i+1 << ": ";
+                for (int j = 0; j < PUZZLE_COLS; j++) {
+                    cin >> _puzzle[i][j];
+                }
+            }
+            cout << '\n';
+            break;
+        default:
+            break;  // Invalid input.
+    }
+
+    cout << "Please select an ALGORITHM by typing the number corresponding to the following: " << '\n'
+         << "\"1\" for Uniform Cost Search" << '\n'
+         << "\"2\" for Misplaced Tile Heuristic" << '\n'
+         << "\"3\" for Manhattan Distance Heuristic" << '\n'
+         << "\"4\" for Weighted A* Manhattan Distance Heuristic" << '\n'
+         << "\"5\" for Anytime A* Manhattan Distance Heuristic" << '\n'
+         << "\"6\" for Partial Expansion A* Manhattan Distance Heuristic" << '\n'
+         << "\"7\" for Compact A* Manhattan Distance Heuristic" << '\n'
+         << "\"8\" for Fringe Search Manhattan Distance Heuristic" << '\n'
+         << "\"9\" for IDA* Manhattan Distance Heuristic" << '\n'
+         << "\"10\" for Perimeter A* Manhattan Distance Heuristic" << '\n'
+         << "\"11\" for Beam Search Manhattan Distance Heuristic" << '\n'
+         << "\"12\" for LRTA* Manhattan Distance Heuristic" << '\n'
+         << "\"13\" for A* Pattern Database Heuristic" << '\n'
+         << "\"14\" for A* Pattern Database Heuristic with Reflected and Dual Lookups" << '\n'
+         << "\"15\" for IDA* Pattern Database Heuristic with Reflected and Dual Lookups" << '\n';
+    int algorithm_type;
+    cin >> algorithm_type;
+    cout << '\n';
+
+    // Reasks the user if input was invalid.
+    while (!(algorithm_type >= 1 && algorithm_type <= 15)) {
+        cout << "Invalid input. Please try again." << '\n'
+             << "Please select an ALGORITHM by typing the number corresponding to the following: " << '\n'
+             << "\"1\" for Uniform Cost Search" << '\n'
+             << "\"2\" for A* Misplaced Tile Heuristic" << '\n'
+             << "\"3\" for A* Manhattan Distance Heuristic" << '\n'
+             << "\"4\" for Weighted A* Manhattan Distance Heuristic" << '\n'
+             << "\"5\" for Anytime A* Manhattan Distance Heuristic" << '\n'
+             << "\"6\" for Partial Expansion A* Manhattan Distance Heuristic" << '\n'
+             << "\"7\" for Compact A* Manhattan Distance Heuristic" << '\n'
+             << "\"8\" for Fringe Search Manhattan Distance Heuristic" << '\n'
+             << "\"9\" for IDA* Manhattan Distance Heuristic" << '\n'
+             << "\"10\" for Perimeter A* Manhattan Distance Heuristic" << '\n'
+             << "\"11\" for Beam Search Manhattan Distance Heuristic" << '\n'
+             << "\"12\" for LRTA* Manhattan Distance Heuristic" << '\n'
+             << "\"13\" for A* Pattern Database Heuristic" << '\n'
+             << "\"14\" for A* Pattern Database Heuristic with Reflected and Dual Lookups" << '\n'
+             << "\"15\" for IDA* Pattern Database Heuristic with Reflected and Dual Lookups" << '\n';
+        cin >> algorithm_type;
+        cout << '\n';
+    }
+
+    _heuristic_type = heuristic_type_for_algorithm(algorithm_type);
+
+    if (algorithm_type == 4 || algorithm_type == 5) {
+        cout << "Please type in the WEIGHT w (at least 1) to multiply the heuristic by." << '\n'
+             << "The solution found is guaranteed to be at most w times the optimal depth." << '\n';
+        cin >> _options.weight;
+        cout << '\n';
+
+        // Reasks the user if input was invalid.
+        while (!(_options.weight >= 1.0)) {
+            cout << "Invalid input. Please try again." << '\n'
+                 << "Please type in the WEIGHT w (at least 1) to multiply the heuristic by." << '\n';
+            cin >> _options.weight;
+            cout << '\n';
+        }
+    }
+
+    if (algorithm_type == 11) {
+        cout << "Please type in the BEAM WIDTH, the number of puzzles kept per depth." << '\n';
+        cin >> _options.beam_width;
+        cout << '\n';
+
+        // Reasks the user if input was invalid.
+        while (!(_options.beam_width >= 1)) {
+            cout << "Invalid input. Please try again." << '\n'
+                 << "Please type in the BEAM WIDTH, the number of puzzles kept per depth." << '\n';
+            cin >> _options.beam_width;
+            cout << '\n';
+        }
+    }
+
+    if (algorithm_type == 12) {
+        cout << "Please type in the LOOKAHEAD depth searched before each move." << '\n';
+        cin >> _options.lookahead;
+        cout << '\n';
+
+        // Reasks the user if input was invalid.
+        while (!(_options.lookahead >= 1)) {
+            cout << "Invalid input. Please try again." << '\n'
+                 << "Please type in the LOOKAHEAD depth searched before each move." << '\n';
+            cin >> _options.lookahead;
+            cout << '\n';
+        }
+    }
+
+    if (algorithm_type == 5) {
+        cout << "Please type in the TIME BUDGET in milliseconds for improving the solution." << '\n';
+        cin >> _options.time_budget_ms;
+        cout << '\n';
+
+        // Reasks the user if input was invalid.
+        while (!(_options.time_budget_ms > 0)) {
+            cout << "Invalid input. Please try again." << '\n'
+                 << "Please type in the TIME BUDGET in milliseconds for improving the solution." << '\n';
+            cin >> _options.time_budget_ms;
+            cout << '\n';
+        }
+    }
+    return;
+}
+
+vector<vector<int>> init_premade_initial_puzzle(int _difficulty) {  // Premade puzzles for testing algorithm.
+    if (PUZZLE_ROWS != 3 || PUZZLE_COLS != 3) {     // Other shapes: a fixed walk from the goal, 4 moves per level.
+        vector<vector<int>> p = PUZZLE_GOAL;
+        int blank = PUZZLE_TILES - 1, last_move = 4;
+        uint32_t seed = 12345;
+        for (int step = 0; step < 4 * max(0, min(_difficulty, 9)); step++) {
+            int m;
+            do {
+                seed = seed * 1103515245 + 12345;
+                m = (seed >> 16) % 4;
+            } while (BOARD.neighbour[blank][m] < 0 || m == (last_move ^ 1));
+            int next = BOARD.neighbour[blank][m];
+            swap(p[blank / PUZZLE_COLS][blank % PUZZLE_COLS], p[next / PUZZLE_COLS][next % PUZZLE_COLS]);
+            blank = next;
+            last_move = m;
+        }
+        return p;
+    }
+    switch(_difficulty) {
+        case 0:
+            return {{1, 2, 3},  // Depth 0
+                    {4, 5, 6},
+                    {7, 8, 0}};
+            break;
+        case 1:
+            return {{1, 2, 3},  // Depth 1
+                    {4, 5, 0},
+                    {7, 8, 6}}; 
+            ;
+        case 2:
+            return {{1, 0, 3},  // Depth 3
+                    {4, 2, 6},
+                    {7, 5, 8}};
+            break;
+        case 3:
+            return {{2, 3, 0},  // Depth 6
+                    {1, 4, 5},
+                    {7, 8, 6}};
+            break;
+        case 4:
+            return {{1, 2, 3},  // Depth 9
+                    {0, 5, 7},
+                    {4, 8, 6}};
+            break;
+        case 5:
+            return {{1, 2, 4},  // Depth 12
+                    {7, 5, 3},
+                    {0, 8, 6}};
+            break;
+        case 6:
+            return {{7, 4, 3},  // Depth 15
+                    {0, 2, 1},
+                    {8, 5, 6}};
+            break;
+        case 7:
+            return {{0, 6, 3},  // Depth 18
+                    {1, 2, 7},
+                    {5, 4, 8}};
+            break;
+        case 8:
+            return {{8, 2, 6},  // Depth 21
+                    {1, 7, 0},
+                    {5, 4, 3}};
+            break;
+        case 9:
+            return {{4, 6, 0},  // Depth 24
+                    {1, 5, 8},
+                    {7, 2, 3}};
+            break;
+        default:
+            return {{1, 2, 3},  // Invalid input.
+                    {4, 5, 6},
+                    {7, 8, 0}};
+            break;
+    }
+}
+
+int misplaced_tile(const vector<vector<int>> &_p) {
+    int dist = 0;
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            if (_p[i][j] == 0) {
+                continue; // Skips the blank tile.
+            }
+            if (_p[i][j] != PUZZLE_GOAL[i][j]) {
+                dist++;
+            }
+        }
+    }
+    return dist;
+}
+
+int manhattan_distance(const vector<vector<int>> &_p) {
+    int dist = 0;
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            if (_p[i][j] == 0) {
+                continue; // Skips the blank tile.
+            }
+            dist += BOARD.manhattan[_p[i][j]][i * PUZZLE_COLS + j];  // Distance to the tile's goal cell.
+        }
+    }
+    return dist;
+}
+
+string heuristic_type_for_algorithm(int _algorithm_type) {   // Maps the ALGORITHM menu numbers to names.
+    switch (_algorithm_type) {
+        case 1:
+            return "Uniform Cost Search";
+        case 2:
+            return "A* Misplaced";
+        case 3:
+            return "A* Manhattan";
+        case 4:
+            return "Weighted A* Manhattan";
+        case 5:
+            return "Anytime A* Manhattan";
+        case 6:
+            return "EPEA* Manhattan";
+        case 7:
+            return "Compact A* Manhattan";
+        case 8:
+            return "Fringe Manhattan";
+        case 9:
+            return "IDA* Manhattan";
+        case 10:
+            return "Perimeter A* Manhattan";
+        case 11:
+            return "Beam Manhattan";
+        case 12:
+            return "LRTA* Manhattan";
+        case 13:
+            return "A* PDB";
+        case 14:
+            return "A* PDB Max";
+        case 15:
+            return "IDA* PDB Max";
+        default:
+            return "";  // Invalid input.
+    }
+}
+
+int compute_heuristic(vector<vector<int>> &_p, string &_heuristic_type) {
+    if (_heuristic_type.find("Manhattan") != string::npos) {
+        return manhattan_distance(_p);
+    }
+    if (_heuristic_type.find("Misplaced") != string::npos) {
+        return misplaced_tile(_p);
+    }
+    if (_heuristic_type.find("PDB") != string::npos) {
+        return pattern_database_heuristic(_p, _heuristic_type.find("Max") != string::npos);
+    }
+    return 0;   // Uniform Cost Search has a heuristic value of 0.
+}
+
+// general_search's heuristics measured towards another goal, for goals that no symmetry maps onto PUZZLE_GOAL:
+// 0 for uniform cost search, the misplaced tiles, or else the Manhattan distance.
+int goal_relative_heuristic(vector<vector<int>> &_p, const vector<vector<int>> &_goal, string &_heuristic_type) {
+    if (_heuristic_type == "Uniform Cost Search") {
+        return 0;
+    }
+    bool misplaced = _heuristic_type.find("Misplaced") != string::npos;
+    int goal_cell[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        goal_cell[_goal[i / PUZZLE_COLS][i % PUZZLE_COLS]] = i;
+    }
+    int dist = 0;
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            if (_p[i][j] == 0) {
+                continue; // Skips the blank tile.
+            }
+            int cell = goal_cell[_p[i][j]];
+            dist += misplaced ? (cell != i * PUZZLE_COLS + j) : abs(cell / PUZZLE_COLS - i) + abs(cell % PUZZLE_COLS - j);
+        }
+    }
+    return dist;
+}
+
+void locate_blank(vector<vector<int>> &_p, int &_x, int &_y) {
+    _x = 0;
+    _y = 0;
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            if (_p[i][j] == 0) {
+                _x = i;
+                _y = j;
+                return;
+            }
+        }
+    }
+}
+
+void print_puzzle(vector<vector<int>> _p, int _g, int _h) {
+    cout << "The best node to expand with a g(n) = " << _g << " and h(n) = " << _h << " is:" << '\n';
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        cout << "[";    
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            cout << _p[i][j];
+            if (j < PUZZLE_COLS-1) {
+                cout << ", ";
+            }
+        }
+        cout << "]" << '\n';
+    }
+}
+
+void print_puzzle_path(PuzzleNode* _goal) {
+    vector<PuzzleNode*> puzzle_path;
+    PuzzleNode* curr = _goal;
+
+    while (curr != nullptr) {   // Traces back to root node.
+        puzzle_path.push_back(curr);
+        curr = curr->parent;
+    }
+    
+    // Makes the path start with the root and end with the goal.
+    reverse(puzzle_path.begin(), puzzle_path.end());
+
+    for (PuzzleNode* node : puzzle_path) {
+        print_puzzle(node->puzzle, node->g, node->h);
+    }
+}
+
+void print_summary(int _g, int _n, int _s) {
+    cout << "Goal state!" << '\n' << '\n'
+         << "Solution depth was " << _g << '\n'
+         << "Number of nodes expanded: " << _n << '\n'
+         << "Max queue size: " << _s << '\n' << '\n';
+}
+
+void print_failure() {
+    cout << "Unfortunately, your puzzle is impossible to solve." << '\n' << '\n';
+}
+
+void print_stopped(SearchResult &_result) {
+    cout << "Search stopped early (" << _result.stop_reason << ")." << '\n' << '\n'
+         << "Best proven lower bound on the solution depth: " << _result.lower_bound << '\n'
+         << "Number of nodes expanded: " << _result.nodes_expanded << '\n'
+         << "Max queue size: " << _result.q_max_size << '\n' << '\n';
+}
+
+// Nodes in a uniform tree with branching factor b down to depth d: 1 + b + ... + b^d.
+double nodes_up_to_depth(double _b, int _d) {
+    return (fabs(_b - 1.0) < 1e-9) ? _d + 1.0 : (pow(_b, _d + 1) - 1) / (_b - 1);
+}
+
+// The effective branching factor b*: the branching factor of a uniform tree of the given depth holding
+// the given number of nodes. Found by bisection, since 1 + b + ... + b^d grows with b.
+double effective_branching_factor(double _nodes, int _depth) {
+    if (_nodes <= 1 || _depth <= 0) {
+        return 0;
+    }
+    double low = 0, high = _nodes;
+    for (int i = 0; i < 100; i++) {
+        double mid = (low + high) / 2;
+        (nodes_up_to_depth(mid, _depth) < _nodes ? low : high) = mid;
+    }
+    return low;
+}
+
+// Prints the expansions per depth and per f layer side by side, then the effective branching factor over
+// the solution depth and how fast the f layers grow.
+void print_layer_stats(SearchResult &_result) {
+    const LayerStats &layers = _result.layers;
+    if (layers.by_depth.empty()) {
+        cout << "No layer statistics for this search mode." << '\n' << '\n';
+        return;
+    }
+    cout << setw(6) << "layer" << setw(14) << "by depth" << setw(14) << "by f" << '\n';
+    size_t rows = max(layers.by_depth.size(), layers.by_f.size());
+    long long total = 0;
+    for (size_t i = 0; i < rows; i++) {
+        long long depth_count = (i < layers.by_depth.size()) ? layers.by_depth[i] : 0;
+        long long f_count = (i < layers.by_f.size()) ? layers.by_f[i] : 0;
+        if (depth_count > 0 || f_count > 0) {
+            cout << setw(6) << i << setw(14) << depth_count << setw(14) << f_count << '\n';
+        }
+        total += depth_count;
+    }
+    int depth = _result.solved ? _result.depth : (int)layers.by_depth.size() - 1;
+    streamsize precision = cout.precision();
+    cout << fixed << setprecision(3)
+         << "Effective branching factor: " << effective_branching_factor(total, depth) << " (" << total
+         << " expansions to depth " << depth << ")" << '\n';
+    if (layers.layer_growth() > 0) {
+        cout << "Growth per f layer: " << layers.layer_growth() << '\n';
+    }
+    cout << defaultfloat << setprecision(precision) << '\n';
+}
+
+// Restarts the kernel's peak RSS (VmHWM) at the current RSS, so the next peak_rss_kb() covers one solve
+// rather than everything the process did before it.
+void reset_peak_rss() {
+    ofstream("/proc/self/clear_refs") << "5";
+}
+
+// Peak RSS in KB since reset_peak_rss(), or over the whole process where /proc is not available.
+long peak_rss_kb() {
+    ifstream status("/proc/self/status");
+    for (string line; getline(status, line); ) {
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            return atol(line.c_str() + 6);
+        }
+    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Prints what the search's structures held, the allocator's and the process's totals, and optionally how
+// much memory the same search would need for a solution of another depth.
+void print_memory_usage(SearchResult &_result, int _projection_depth) {
+    const MemoryUsage &memory = _result.memory;
+    size_t total = memory.frontier_bytes + memory.closed_bytes + memory.arena_bytes;
+    const double MB = 1024.0 * 1024.0;
+    streamsize precision = cout.precision();
+    cout << fixed << setprecision(3);
+    if (total > 0) {
+        cout << "Memory: frontier " << memory.frontier_bytes / MB << " MB, closed set " << memory.closed_bytes / MB << " MB";
+        if (memory.closed_load_factor > 0) {
+            cout << " (load factor " << memory.closed_load_factor << ")";
+        }
+        cout << ", arena " << memory.arena_bytes / MB << " MB" << '\n';
+        if (memory.stored_nodes > 0) {
+            cout << "Stored nodes: " << memory.stored_nodes << ", " << setprecision(1) << (double)total / memory.stored_nodes
+                 << " bytes per node" << setprecision(3) << '\n';
+        }
+    }
+    if (memory.heuristic_bytes > 0) {
+        cout << "Heuristic tables: " << memory.heuristic_bytes / MB << " MB, shared by every solve" << '\n';
+    }
+    cout << "Allocator in use: " << mallinfo2().uordblks / MB << " MB, peak RSS during the solve: " << peak_rss_kb() / 1024.0 << " MB" << '\n';
+
+    // Stored nodes grow like 1 + b + ... + b^d with the effective branching factor b.
+    int depth = _result.solved ? _result.depth : _result.lower_bound;
+    if (_projection_depth > 0 && memory.bounded) {
+        cout << "Projected memory at depth " << _projection_depth << ": "
+             << (total + max(0, _projection_depth - depth) * sizeof(uint64_t)) / MB << " MB (only the path grows)" << '\n';
+    } else if (_projection_depth > 0 && memory.stored_nodes > 1 && depth > 0) {
+        double b = effective_branching_factor(memory.stored_nodes, depth);
+        double projected = nodes_up_to_depth(b, _projection_depth) * total / memory.stored_nodes;
+        cout << "Projected memory at depth " << _projection_depth << ": " << projected / MB << " MB (effective branching factor "
+             << setprecision(3) << b << " over depth " << depth << ")" << '\n';
+    }
+    cout << defaultfloat << setprecision(precision) << '\n';
+}
+
+string trace_moves(PuzzleNode* _goal) {
+    string moves;
+    for (PuzzleNode* curr = _goal; curr != nullptr && curr->parent != nullptr; curr = curr->parent) {
+        int dx = curr->x_blank - curr->parent->x_blank, dy = curr->y_blank - curr->parent->y_blank;
+        moves += (dx < 0) ? 'U' : (dx > 0) ? 'D' : (dy < 0) ? 'L' : 'R';
+    }
+    reverse(moves.begin(), moves.end());    // Traced from the goal, so reversed to start at the root.
+    return moves;
+}
+
+// Reads the optional command line flags (see README.md); false, after saying why, if one has an unknown value.
+bool parse_search_flags(int argc, char* argv[], SearchOptions &_options) {
+    for (int i = 1; i+1 < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--deadline-ms") {
+            _options.deadline_ms = atof(argv[++i]);
+        } else if (flag == "--max-nodes") {
+            _options.max_nodes = atoll(argv[++i]);
+        } else if (flag == "--checkpoint") {
+            _options.checkpoint_path = argv[++i];
+        } else if (flag == "--checkpoint-every-ms") {
+            _options.checkpoint_every_ms = atof(argv[++i]);
+        } else if (flag == "--resume") {
+            _options.resume_path = argv[++i];
+        } else if (flag == "--tt-entries") {
+            _options.transposition_entries = atoll(argv[++i]);
+        } else if (flag == "--move-pruning") {
+            _options.move_pruning = string(argv[++i]) != "off";
+        } else if (flag == "--perimeter-depth") {
+            _options.perimeter_depth = max(0, atoi(argv[++i]));
+        } else if (flag == "--beam-width") {
+            _options.beam_width = max(1, atoi(argv[++i]));
+        } else if (flag == "--lookahead") {
+            _options.lookahead = max(1, atoi(argv[++i]));
+        } else if (flag == "--learned-limit") {
+            _options.learned_limit = max(0LL, atoll(argv[++i]));
+        } else if (flag == "--trials") {
+            _options.trials = max(1, atoi(argv[++i]));
+        } else if (flag == "--pdb-compression") {  // Process-wide, since the tables are shared.
+            pattern_database_compression = argv[++i];
+            if (pattern_database_compression != "none" && pattern_database_compression != "min") {
+                cerr << "Unknown --pdb-compression \"" << pattern_database_compression << "\"; expected none or min." << '\n';
+                return false;
+            }
+        } else if (flag == "--pdb-blank-mod3") {
+            if (string(argv[++i]) != "off") {
+                pattern_database_compression = "blank-mod3";
+            } else if (pattern_database_compression == "blank-mod3") {
+                pattern_database_compression = "none";
+            }
+        } else if (flag == "--pdb-block") {
+            pattern_database_block = max(1, atoi(argv[++i]));
+        } else if (flag == "--memory-projection") {
+            _options.projection_depth = max(0, atoi(argv[++i]));
+        } else if (flag == "--trace") {
+            _options.trace_path = argv[++i];
+        } else if (flag == "--generation-checks") {
+            _options.generation_checks = string(argv[++i]) != "off";
+        } else if (flag == "--layers") {
+            _options.print_layers = string(argv[++i]) != "off";
+        } else if (flag == "--goal") {     // The goal's tiles in row-major order, as one argument.
+            istringstream tiles(argv[++i]);
+            _options.goal.assign(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+            for (int t = 0; t < PUZZLE_TILES; t++) {
+                tiles >> _options.goal[t / PUZZLE_COLS][t % PUZZLE_COLS];
+            }
+        }
+    }
+    return true;
+}
+
+// Runs the search mode that matches the heuristic type with a throwaway context.
+SearchResult run_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options) {
+    SearchContext context;
+    return context.solve(problem, heuristic_type, options);
+}
+
+// Runs the search mode that matches the heuristic type, reusing this context's memory.
+SearchResult SearchContext::solve(vector<vector<int>> problem, string heuristic_type, SearchOptions options) {
+    if (!options.goal.empty() && options.goal != PUZZLE_GOAL) {
+        return solve_for_goal(problem, heuristic_type, options, *this);
+    }
+    reset();
+    SearchResult result = dispatch(problem, heuristic_type, options);
+    if (heuristic_type.find("PDB") != string::npos) {
+        result.memory.heuristic_bytes = pattern_database_memory();
+    }
+    queue.heap().clear();   // Frees the queued grids as part of this solve rather than at the start of the next.
+    return result;
+}
+
+// Runs the search mode that matches the heuristic type on the freshly reset context.
+SearchResult SearchContext::dispatch(vector<vector<int>> problem, string heuristic_type, SearchOptions options) {
+    if (!options.resume_path.empty() && is_ida_star_checkpoint(options.resume_path)) {
+        return ida_star_search(problem, heuristic_type, options, *this);   // The checkpoint names the heuristic.
+    }
+    if (heuristic_type == "Anytime A* Manhattan") {
+        return anytime_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "EPEA* Manhattan") {
+        return partial_expansion_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "Compact A* Manhattan") {
+        return compact_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "Fringe Manhattan") {
+        return fringe_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type.compare(0, 4, "IDA*") == 0) {
+        return ida_star_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "Perimeter A* Manhattan") {
+        return perimeter_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "Beam Manhattan") {
+        return beam_search(problem, heuristic_type, options, *this);
+    }
+    if (heuristic_type == "LRTA* Manhattan") {
+        return lrta_star_search(problem, heuristic_type, options, *this);
+    }
+    return general_search(problem, heuristic_type, options, *this);
+}
+
+template <typename T>
+void put_value(string &_buffer, T _value) {
+    _buffer.append(reinterpret_cast<const char*>(&_value), sizeof(T));
+}
+
+template <typename T>
+T get_value(istream &_in) {
+    T value{};
+    _in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return value;
+}
+
+void put_puzzle(string &_buffer, const vector<vector<int>> &_p) {
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            put_value<uint8_t>(_buffer, _p[i][j]);
+        }
+    }
+}
+
+vector<vector<int>> get_puzzle(istream &_in) {
+    vector<vector<int>> p(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            p[i][j] = get_value<uint8_t>(_in);
+        }
+    }
+    return p;
+}
+
+// True if the grid has PUZZLE_ROWS x PUZZLE_COLS cells holding each tile, blank included, exactly once.
+bool is_tile_permutation(const vector<vector<int>> &_p) {
+    vector<bool> seen(PUZZLE_TILES, false);
+    if (_p.size() != (size_t)PUZZLE_ROWS) {
+        return false;
+    }
+    for (const vector<int> &row : _p) {
+        if (row.size() != (size_t)PUZZLE_COLS) {
+            return false;
+        }
+        for (int tile : row) {
+            if (tile < 0 || tile >= PUZZLE_TILES || seen[tile]) {
+                return false;
+            }
+            seen[tile] = true;
+        }
+    }
+    return true;
+}
+
+// Bytes a checkpoint has left after the read position. Every count read from a file is checked against it
+// before anything is allocated, so a corrupt count fails the load instead of exhausting memory.
+int64_t bytes_left(istream &_in) {
+    if (!_in) {
+        return 0;
+    }
+    streampos here = _in.tellg();
+    _in.seekg(0, ios::end);
+    streampos end = _in.tellg();
+    _in.seekg(here);
+    return (int64_t)(end - here);
+}
+
+// Reads a length-prefixed string such as the heuristic name; false if the length does not fit the file.
+bool get_string(istream &_in, string &_text) {
+    int32_t length = get_value<int32_t>(_in);
+    if (!_in || length < 0 || length > bytes_left(_in)) {
+        return false;
+    }
+    _text.assign(length, ' ');
+    _in.read(&_text[0], length);
+    return (bool)_in;
+}
+
+// Checkpoint layout: a header (magic, shape, algorithm, weight, problem, counters), then every
+// node reachable through parent pointers with parents before children, then the queue's heap in
+// order (parents referenced by index), then the visited puzzles with the g they were expanded at. Tiles
+// are stored as one byte each.
+const string CHECKPOINT_MAGIC = "NPZCKPT2";
+
+string serialize_search(vector<vector<int>> &_problem, string &_heuristic_type, double _weight, PuzzleQueue &_q,
+                        StampedMap<vector<vector<int>>, int> &_visits, int _nodes_expanded, int _q_max_size) {
+    string buffer = CHECKPOINT_MAGIC;
+    put_value<int32_t>(buffer, PUZZLE_SHAPE);
+    put_value<int32_t>(buffer, _heuristic_type.size());
+    buffer += _heuristic_type;
+    put_value<double>(buffer, _weight);
+    put_puzzle(buffer, _problem);
+    put_value<int32_t>(buffer, _nodes_expanded);
+    put_value<int32_t>(buffer, _q_max_size);
+
+    // Numbers the ancestors of every queued node; -1 stands for no parent.
+    map<PuzzleNode*, int32_t> node_ids = {{nullptr, -1}};
+    vector<PuzzleNode*> arena;
+    for (PuzzleNode &node : _q.heap()) {
+        vector<PuzzleNode*> chain;
+        for (PuzzleNode* curr = node.parent; !node_ids.count(curr); curr = curr->parent) {
+            chain.push_back(curr);
+        }
+        for (auto it = chain.rbegin(); it != chain.rend(); it++) {   // Parents get smaller ids.
+            node_ids[*it] = arena.size();
+            arena.push_back(*it);
+        }
+    }
+
+    auto put_node = [&](PuzzleNode &_node) {
+        put_puzzle(buffer, _node.puzzle);
+        put_value<int32_t>(buffer, _node.g);
+        put_value<int32_t>(buffer, _node.h);
+        put_value<double>(buffer, _node.f);
+        put_value<int32_t>(buffer, node_ids[_node.parent]);
+    };
+    put_value<int64_t>(buffer, arena.size());
+    for (PuzzleNode* node : arena) {
+        put_node(*node);
+    }
+    put_value<int64_t>(buffer, _q.heap().size());
+    for (PuzzleNode &node : _q.heap()) {
+        put_node(node);
+    }
+
+    put_value<int64_t>(buffer, _visits.size());
+    _visits.for_each([&](const vector<vector<int>> &_puzzle, int _g) {
+        put_puzzle(buffer, _puzzle);
+        put_value<int32_t>(buffer, _g);
+    });
+    return buffer;
+}
+
+bool load_checkpoint(string _path, vector<vector<int>> &_problem, string &_heuristic_type, double &_weight, PuzzleQueue &_q,
+                     StampedMap<vector<vector<int>>, int> &_visits, PuzzleNodeArena &_parents, int &_nodes_expanded, int &_q_max_size) {
+    ifstream in(_path, ios::binary);
+    string magic(CHECKPOINT_MAGIC.size(), ' ');
+    in.read(&magic[0], magic.size());
+    if (!in || magic != CHECKPOINT_MAGIC || get_value<int32_t>(in) != PUZZLE_SHAPE || !get_string(in, _heuristic_type)) {
+        return false;
+    }
+    _weight = get_value<double>(in);
+    _problem = get_puzzle(in);
+    _nodes_expanded = get_value<int32_t>(in);
+    _q_max_size = get_value<int32_t>(in);
+    if (!in || !is_tile_permutation(_problem) || _nodes_expanded < 0 || _q_max_size < 0) {
+        return false;
+    }
+
+    // Nodes may only point at parents read before them, so a corrupt id fails the load.
+    const int64_t NODE_BYTES = PUZZLE_TILES + 3 * sizeof(int32_t) + sizeof(double), VISIT_BYTES = PUZZLE_TILES + sizeof(int32_t);
+    vector<PuzzleNode*> arena;
+    auto get_node = [&](PuzzleNode &_node) {
+        vector<vector<int>> puzzle = get_puzzle(in);
+        int g = get_value<int32_t>(in), h = get_value<int32_t>(in);
+        double f = get_value<double>(in);
+        int32_t parent_id = get_value<int32_t>(in);
+        if (!in || !is_tile_permutation(puzzle) || parent_id < -1 || parent_id >= (int64_t)arena.size()
+            || g < 0 || g > UINT16_MAX || h < 0 || h > UINT16_MAX || !(f >= 0)) {
+            return false;
+        }
+        int x_blank, y_blank;
+        locate_blank(puzzle, x_blank, y_blank);
+        _node = PuzzleNode(puzzle, x_blank, y_blank, g, h, parent_id < 0 ? nullptr : arena[parent_id]);
+        _node.f = f;
+        return true;
+    };
+    PuzzleNode node = PuzzleNode(_problem, 0, 0, 0, 0, nullptr);  // Filled in by get_node().
+    int64_t arena_size = get_value<int64_t>(in);
+    if (!in || arena_size < 0 || arena_size > bytes_left(in) / NODE_BYTES) {
+        return false;
+    }
+    for (int64_t i = 0; i < arena_size; i++) {
+        if (!get_node(node)) {
+            return false;
+        }
+        arena.push_back(_parents.add(node));
+    }
+    int64_t heap_size = get_value<int64_t>(in);
+    if (!in || heap_size < 0 || heap_size > bytes_left(in) / NODE_BYTES) {
+        return false;
+    }
+    for (int64_t i = 0; i < heap_size; i++) {
+        if (!get_node(node)) {
+            return false;
+        }
+        _q.heap().push_back(node);  // Already in heap order, so no re-heapifying is needed.
+    }
+
+    int64_t visits_size = get_value<int64_t>(in);
+    if (!in || visits_size < 0 || visits_size > bytes_left(in) / VISIT_BYTES) {
+        return false;
+    }
+    for (int64_t i = 0; i < visits_size; i++) {
+        vector<vector<int>> puzzle = get_puzzle(in);
+        int g = get_value<int32_t>(in);
+        if (!in || !is_tile_permutation(puzzle) || g < 0 || g > UINT16_MAX) {
+            return false;
+        }
+        _visits[puzzle] = g;
+    }
+    return true;
+}
+
+// Serializes and writes a snapshot from a forked child, which sees the search state as it was at the fork
+// through copy-on-write pages: the search only pauses for the fork itself, however large its state, and
+// memory grows only by the pages it changes meanwhile. The file is written under a temporary name first so
+// a crash never leaves a torn checkpoint. If fork() fails the snapshot is written in place instead.
+void write_checkpoint(pid_t &_writer, string _path, const function<string()> &_serialize) {
+    wait_checkpoint(_writer);   // At most one snapshot is in flight at a time.
+    _writer = fork();
+    if (_writer == 0) {
+        _exit(write_file_atomically(_path, _serialize()) ? 0 : 1);  // Skips the parent's exit handlers and unflushed output.
+    }
+    if (_writer < 0) {
+        write_file_atomically(_path, _serialize());
+    }
+}
+
+// Writes `_buffer` under a temporary name and renames it into place, so `_path` is never left half written.
+bool write_file_atomically(string _path, const string &_buffer) {
+    string temp_path = _path + ".tmp";
+    ofstream out(temp_path, ios::binary | ios::trunc);
+    out.write(_buffer.data(), _buffer.size());
+    out.close();
+    return out && rename(temp_path.c_str(), _path.c_str()) == 0;
+}
+
+// Waits for the snapshot in flight, if any, to reach the disk.
+void wait_checkpoint(pid_t &_writer) {
+    if (_writer > 0) {
+        waitpid(_writer, nullptr, 0);
+        _writer = -1;
+    }
+}
+
+// Memory of the modes built on PuzzleNode: `_frontier_peak` queued nodes plus the context's puzzle maps and
+// parent arena, which keep their capacity from earlier solves. Counts each puzzle's rows but not allocator headers.
+// Every queued or expanded board is in puzzle_g, so it alone gives the distinct boards stored.
+MemoryUsage puzzle_search_memory(size_t _frontier_peak, SearchContext &_context) {
+    const size_t rows_bytes = PUZZLE_ROWS * (sizeof(vector<int>) + PUZZLE_COLS * sizeof(int));
+    MemoryUsage memory;
+    memory.frontier_bytes = _frontier_peak * (sizeof(PuzzleNode) + rows_bytes);
+    memory.closed_bytes = _context.puzzle_g.memory_bytes(rows_bytes) + _context.closed_puzzles.memory_bytes(rows_bytes)
+                        + _context.anytime_nodes.memory_bytes(rows_bytes);
+    memory.closed_load_factor = _context.puzzle_g.load_factor();
+    memory.arena_bytes = _context.parents.memory_bytes(rows_bytes);
+    memory.stored_nodes = _context.puzzle_g.size();
+    return memory;
+}
+
+SearchResult general_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+
+    // The goal is PUZZLE_GOAL unless solve_for_goal() searches towards another one directly.
+    const vector<vector<int>> &goal = options.goal.empty() ? PUZZLE_GOAL : options.goal;
+    auto node_heuristic = [&](vector<vector<int>> &_p) {
+        return options.goal.empty() ? compute_heuristic(_p, heuristic_type) : goal_relative_heuristic(_p, goal, heuristic_type);
+    };
+
+    // Set heuristic type for root_node (original problem/puzzle).
+    int heuristic = node_heuristic(problem);
+    
+    // Creates a queue that prioritizes SMALLER costs of cheapest solutions first for the puzzle's nodes.
+    PuzzleQueue &q = context.queue;
+    PuzzleNode root_node = PuzzleNode(problem, x_blank, y_blank, 0, heuristic, nullptr);
+    root_node.f = root_node.g + options.weight * root_node.h;
+    q.push(root_node);
+
+    // Remembers visited puzzle nodes as keys and the g they were expanded with as values. With generation
+    // checks it also holds every queued puzzle not yet expanded, as -(g+1) for the smallest g it was queued with.
+    StampedMap<vector<vector<int>>, int> &puzzle_visits = context.puzzle_g;
+
+    int nodes_expanded = 0, q_max_size = 1;
+    int nodes_reopened = 0, bpmx_updates = 0;
+    PuzzleNodeArena &parents = context.parents;     // Expanded nodes copied as their children's parent.
+    long long pruned_duplicates = 0, pruned_reversals = 0;
+    bool goal_at_generation = false;
+    if (!options.resume_path.empty()) {     // Picks up exactly where the checkpointed search left off.
+        q.heap().clear();
+        if (!load_checkpoint(options.resume_path, problem, heuristic_type, options.weight,
+                             q, puzzle_visits, parents, nodes_expanded, q_max_size)) {
+            cout << "Unable to resume from checkpoint \"" << options.resume_path << "\"." << '\n' << '\n';
+            return result;
+        }
+        limits.options.weight = options.weight;
+        if (options.verbose) {
+            cout << "Resumed " << heuristic_type << " after " << nodes_expanded << " expanded nodes." << '\n' << '\n';
+        }
+    }
+
+    pid_t checkpoint_writer = -1;
+    auto serialize = [&]() {
+        return serialize_search(problem, heuristic_type, options.weight, q, puzzle_visits, nodes_expanded, q_max_size);
+    };
+
+    // Successful search, whether the goal was popped or found among the children.
+    auto finish = [&](PuzzleNode &_goal) {
+        if (options.verbose) {
+            print_puzzle_path(&_goal);
+            print_summary(_goal.g, nodes_expanded, q_max_size);
+            if (options.weight > 1.0) {
+                cout << "Suboptimality bound: " << options.weight << '\n' << '\n';
+            }
+            if (nodes_reopened > 0 || bpmx_updates > 0) {
+                cout << "Nodes reopened: " << nodes_reopened << ", BPMX updates: " << bpmx_updates << '\n' << '\n';
+            }
+            if (options.generation_checks) {
+                cout << "Pruned at generation: " << pruned_duplicates << " duplicates, " << pruned_reversals << " moves straight back" << '\n'
+                     << "Goal found " << (goal_at_generation ? "at generation" : "when popped") << '\n' << '\n';
+            }
+        }
+        wait_checkpoint(checkpoint_writer);
+        result.solved = true;
+        result.depth = _goal.g;
+        result.moves = trace_moves(&_goal);
+        result.lower_bound = (options.weight > 1.0) ? (int)ceil(_goal.g / options.weight) : _goal.g;
+        result.nodes_expanded = nodes_expanded;
+        result.nodes_reopened = nodes_reopened;
+        result.q_max_size = q_max_size;
+        result.memory = puzzle_search_memory(q_max_size, context);
+        return result;
+    };
+
+    while (!q.empty()) {
+        q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
+
+        if (limits.should_checkpoint(nodes_expanded)) {
+            write_checkpoint(checkpoint_writer, options.checkpoint_path, serialize);
+        }
+        if (limits.should_stop(nodes_expanded)) {
+            if (!options.checkpoint_path.empty()) {     // Saves the progress so the search can be resumed later.
+                write_checkpoint(checkpoint_writer, options.checkpoint_path, serialize);
+                wait_checkpoint(checkpoint_writer);
+                if (options.verbose) {
+                    cout << "Checkpoint saved to \"" << options.checkpoint_path << "\"." << '\n';
+                }
+            }
+
+            // Nothing cheaper than the smallest unweighted f still in q can be the optimal solution.
+            result.lower_bound = INT32_MAX;
+            while (!q.empty()) {
+                result.lower_bound = min(result.lower_bound, q.top().g + q.top().h);
+                q.pop();
+            }
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = puzzle_search_memory(q_max_size, context);
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+
+        PuzzleNode curr = q.top();
+        q.pop();
+        nodes_expanded++;
+
+        // Skip already visited nodes, unless this path is cheaper: with an inconsistent heuristic a node can be
+        // expanded before its best path is found, and is then reopened. Weighted A* keeps its bound without
+        // reopening, so it never does. A copy queued with a larger g than another one is skipped as well.
+        int* visit = puzzle_visits.find(curr.puzzle);
+        if (visit != nullptr && *visit >= 0) {
+            if (curr.g >= *visit || options.weight > 1.0) {
+                continue;
+            }
+            nodes_reopened++;
+        } else if (visit != nullptr && curr.g > -*visit - 1) {
+            continue;
+        }
+        if (visit == nullptr) {
+            puzzle_visits.emplace(curr.puzzle, curr.g);     // Remembers this node.
+        } else {
+            *visit = curr.g;
+        }
+        result.layers.record(curr.g, curr.g + curr.h);
+        if (expansion_tracer != nullptr) {
+            expansion_tracer->record(PUZZLE_TILES <= 16 ? pack_puzzle(curr.puzzle) : 0, curr.x_blank * PUZZLE_COLS + curr.y_blank,
+                                     curr.g, curr.h, (int)curr.f, q.size());
+        }
+
+        if (curr.puzzle == goal) {  // Successful search.
+            return finish(curr);
+        }
+
+        // Bidirectional pathmax (BPMX): moves cost 1, so a child's h minus 1 is also a lower bound for the
+        // node, and the node's h minus 1 for each child. Only an inconsistent heuristic changes anything.
+        vector<PuzzleNode> children;
+        for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+            int new_blank = BOARD.neighbour[curr.x_blank * PUZZLE_COLS + curr.y_blank][m];
+            if (new_blank < 0) {
+                continue;   // Ignore tiles that are out-of-bounds.
+            }
+            int new_x_blank = new_blank / PUZZLE_COLS, new_y_blank = new_blank % PUZZLE_COLS;
+            if (options.generation_checks && m == (curr.move ^ 1)) {   // Moves come in pairs: up/down, left/right.
+                pruned_reversals++;
+                continue;   // Straight back to the parent, which is already closed.
+            }
+
+            vector<vector<int>> new_puzzle = curr.puzzle;
+            swap(new_puzzle[curr.x_blank][curr.y_blank], new_puzzle[new_x_blank][new_y_blank]);
+
+            // Drops the children that would only be skipped when popped: expanded or queued before with a g at
+            // least as small, or for weighted A*, which never reopens, expanded at all. The same lookup records a
+            // new child as queued.
+            if (options.generation_checks) {
+                auto visit = puzzle_visits.emplace(new_puzzle, -(curr.g + 2));    // Queued with g = curr.g + 1.
+                if (!visit.second) {
+                    bool expanded = *visit.first >= 0;
+                    int best_g = expanded ? *visit.first : -*visit.first - 1;
+                    if (curr.g + 1 >= best_g || (expanded && options.weight > 1.0)) {
+                        pruned_duplicates++;
+                        continue;
+                    }
+                    if (!expanded) {
+                        *visit.first = -(curr.g + 2);
+                    }
+                }
+            }
+
+            // Makes sure new_puzzle has matching heuristic type.
+            heuristic = node_heuristic(new_puzzle);
+            
+            children.push_back(PuzzleNode(new_puzzle, new_x_blank, new_y_blank, curr.g+1, heuristic, nullptr));
+            children.back().move = m;
+            if (heuristic - 1 > curr.h) {
+                curr.h = heuristic - 1;
+                bpmx_updates++;
+            }
+        }
+        PuzzleNode* parent = parents.add(curr);
+        for (PuzzleNode &child : children) {
+            if (curr.h - 1 > child.h) {
+                child.h = curr.h - 1;
+                bpmx_updates++;
+            }
+            child.parent = parent;
+            child.f = child.g + options.weight * child.h;   // Weighted A* inflates h by w.
+        }
+
+        // A goal child can be returned right away when it would be the next node popped anyway: no queued node
+        // or sibling has a smaller f, and every path still open costs at least its f. Uniform cost search needs
+        // no check: every queued node is at least as deep as this one and, not being the goal, needs a move more.
+        if (options.generation_checks) {
+            for (PuzzleNode &child : children) {
+                if (child.puzzle != goal) {
+                    continue;
+                }
+                bool next_popped = heuristic_type == "Uniform Cost Search" || q.empty() || child.f <= q.top().f;
+                for (PuzzleNode &sibling : children) {
+                    next_popped = next_popped && child.f <= sibling.f;
+                }
+                if (next_popped) {
+                    goal_at_generation = true;
+                    return finish(child);
+                }
+            }
+        }
+        for (PuzzleNode &child : children) {
+            q.push(child);
+        }
+    }
+    wait_checkpoint(checkpoint_writer);
+    if (options.verbose) {
+        print_failure();    // Unsuccessful search.
+    }
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = q_max_size;
+    result.memory = puzzle_search_memory(q_max_size, context);
+    return result;
+}
+
+// Anytime Repairing A* (ARA*): runs weighted A* with a large w to find a quick solution, then keeps
+// lowering w and repairing the previous search (reusing its g values) until w reaches 1 or time runs out.
+// Every node lives in the context's arena and the queue holds pointers to them, so a warm context
+// expands without allocating.
+SearchResult anytime_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    auto elapsed_ms = [&limits]() { return limits.elapsed_ms(); };
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+
+    double weight = options.weight;
+    vector<PuzzleNode*> &q = context.anytime_queue;     // Min-heap maintained with push_heap/pop_heap.
+    auto later = [](const PuzzleNode* _a, const PuzzleNode* _b) { return _a->f > _b->f; };
+    StampedMap<vector<vector<int>>, int> &best_g = context.puzzle_g;    // Cheapest known cost to reach each puzzle.
+    StampedMap<vector<vector<int>>, uint8_t> &closed_puzzles = context.closed_puzzles;     // Expanded during the current weight's pass.
+    // Latest (cheapest) node for each puzzle waiting in q (q may also hold stale copies), or improved after
+    // it was already closed this pass (INCONS).
+    StampedMap<vector<vector<int>>, AnytimeEntry> &anytime_nodes = context.anytime_nodes;
+    PuzzleNodeArena &nodes = context.parents;   // Every generated node, so children can point at their parents.
+
+    PuzzleNode* root_node = nodes.add(PuzzleNode(problem, x_blank, y_blank, 0, compute_heuristic(problem, heuristic_type), nullptr));
+    root_node->f = root_node->g + weight * root_node->h;
+    q.push_back(root_node);
+    best_g[problem] = 0;
+    anytime_nodes[problem] = {root_node, AnytimeEntry::OPEN};
+
+    PuzzleNode* best_goal = (problem == PUZZLE_GOAL) ? root_node : nullptr;
+    int nodes_expanded = 0, q_max_size = 1;
+    auto search_memory = [&]() {    // The queue holds pointers; the nodes are counted in the arena.
+        MemoryUsage memory = puzzle_search_memory(0, context);
+        memory.frontier_bytes = q.capacity() * sizeof(PuzzleNode*);
+        return memory;
+    };
+    while (elapsed_ms() < options.time_budget_ms) {
+        // Expands until nothing left in q can beat the current goal's weighted cost.
+        while (!q.empty() && elapsed_ms() < options.time_budget_ms) {
+            q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
+            if (best_goal != nullptr && best_goal->g <= q.front()->f) {
+                break;
+            }
+            if (limits.should_stop(nodes_expanded)) {
+                break;
+            }
+
+            pop_heap(q.begin(), q.end(), later);
+            PuzzleNode* curr = q.back();
+            q.pop_back();
+            AnytimeEntry* open = anytime_nodes.find(curr->puzzle);
+            if (open == nullptr || open->list != AnytimeEntry::OPEN || open->node != curr) {
+                continue;   // Skip stale copies of puzzles that were reached more cheaply.
+            }
+            open->list = AnytimeEntry::NONE;
+            closed_puzzles.emplace(curr->puzzle, 1);
+            nodes_expanded++;
+
+            for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+                int new_blank = BOARD.neighbour[curr->x_blank * PUZZLE_COLS + curr->y_blank][m];
+                if (new_blank < 0) {
+                    continue;   // Ignore tiles that are out-of-bounds.
+                }
+                int new_x_blank = new_blank / PUZZLE_COLS, new_y_blank = new_blank % PUZZLE_COLS;
+
+                // The child is made in the arena's next slot, which reuses that slot's grid, and taken back
+                // if the puzzle was already reached at least as cheaply.
+                PuzzleNode* child = nodes.add(*curr);
+                vector<vector<int>> &new_puzzle = child->puzzle;
+                swap(new_puzzle[curr->x_blank][curr->y_blank], new_puzzle[new_x_blank][new_y_blank]);
+                int* known = best_g.find(new_puzzle);
+                if (known != nullptr && *known <= curr->g+1) {
+                    nodes.drop_last();
+                    continue;
+                }
+                best_g[new_puzzle] = curr->g+1;
+                child->x_blank = new_x_blank;
+                child->y_blank = new_y_blank;
+                child->g = curr->g+1;
+                child->h = compute_heuristic(new_puzzle, heuristic_type);
+                child->f = child->g + weight * child->h;
+                child->parent = curr;
+                child->move = m;
+
+                if (new_puzzle == PUZZLE_GOAL) {    // Remembers the cheapest goal found so far.
+                    best_goal = child;
+                }
+                if (closed_puzzles.find(new_puzzle) != nullptr) {
+                    anytime_nodes[new_puzzle] = {child, AnytimeEntry::INCONS};  // Revisited next pass instead of reopening now.
+                } else {
+                    anytime_nodes[new_puzzle] = {child, AnytimeEntry::OPEN};
+                    q.push_back(child);
+                    push_heap(q.begin(), q.end(), later);
+                }
+            }
+        }
+
+        // The smallest unweighted f still waiting to be expanded is a lower bound on the optimal depth.
+        double min_f = (best_goal != nullptr) ? best_goal->g : INT32_MAX;
+        anytime_nodes.for_each([&](const vector<vector<int>>&, const AnytimeEntry &_entry) {
+            if (_entry.list != AnytimeEntry::NONE) {
+                min_f = min(min_f, (double)(_entry.node->g + _entry.node->h));
+            }
+        });
+        result.nodes_expanded = nodes_expanded;
+        result.q_max_size = q_max_size;
+        result.memory = search_memory();
+
+        if (best_goal == nullptr) {
+            if (q.empty() && limits.stop_reason.empty()) {
+                if (options.verbose) {
+                    print_failure();    // Unsuccessful search.
+                }
+            } else {
+                result.stop_reason = limits.stop_reason.empty() ? "time budget" : limits.stop_reason;
+                result.lower_bound = (int)min_f;
+                if (options.verbose) {
+                    print_stopped(result);
+                }
+            }
+            return result;
+        }
+        result.lower_bound = (int)ceil(min_f);
+
+        double bound = (min_f > 0) ? min(weight, best_goal->g / min_f) : 1.0;
+        if (options.verbose) {
+            cout << "Solution depth " << best_goal->g << " found with weight " << weight
+                 << " and proven suboptimality bound " << bound << " after " << elapsed_ms() << " milliseconds" << '\n';
+        }
+
+        if (bound <= 1.0 || !limits.stop_reason.empty()) {
+            break;  // The solution is proven optimal, or the search was told to stop.
+        }
+
+        // Lowers the weight, moves the inconsistent puzzles back into q and rebuilds q with the new priorities.
+        weight = max(1.0, weight - options.weight_step);
+        closed_puzzles.clear();
+        q.clear();
+        anytime_nodes.for_each([&](const vector<vector<int>>&, AnytimeEntry &_entry) {
+            if (_entry.list == AnytimeEntry::NONE) {
+                return;
+            }
+            _entry.list = AnytimeEntry::OPEN;
+            _entry.node->f = _entry.node->g + weight * _entry.node->h;
+            q.push_back(_entry.node);
+        });
+        make_heap(q.begin(), q.end(), later);
+    }
+    if (options.verbose) {
+        cout << '\n';
+        print_puzzle_path(best_goal);
+        print_summary(best_goal->g, nodes_expanded, q_max_size);
+    }
+    result.solved = true;
+    result.stop_reason = limits.stop_reason;
+    result.depth = best_goal->g;
+    result.moves = trace_moves(best_goal);
+    return result;
+}
+
+
+// Goal tiles in row-major order, e.g. 1 2 3 4 5 6 7 8 0 for the 3x3 puzzle.
+const vector<uint8_t>& goal_tiles() {
+    static const vector<uint8_t> tiles = []() {
+        vector<uint8_t> t;
+        for (const vector<int> &row : PUZZLE_GOAL) {
+            t.insert(t.end(), row.begin(), row.end());
+        }
+        return t;
+    }();
+    return tiles;
+}
+
+// Numbers every arrangement of the tiles from 0 to n!-1 (Lehmer code). Only used for boards of at most
+// 9 tiles, where the whole state space fits in a byte table.
+uint32_t rank_tiles(const uint8_t* _tiles) {
+    uint32_t rank = 0;
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        int smaller_after = 0;
+        for (int j = i+1; j < PUZZLE_TILES; j++) {
+            smaller_after += _tiles[j] < _tiles[i];
+        }
+        rank = rank * (PUZZLE_TILES - i) + smaller_after;
+    }
+    return rank;
+}
+
+void unrank_tiles(uint32_t _rank, uint8_t* _tiles) {
+    int digits[PUZZLE_TILES];
+    for (int i = PUZZLE_TILES-1; i >= 0; i--) {
+        digits[i] = _rank % (PUZZLE_TILES - i);
+        _rank /= (PUZZLE_TILES - i);
+    }
+    vector<uint8_t> unused(PUZZLE_TILES);
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        unused[i] = i;
+    }
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        _tiles[i] = unused[digits[i]];
+        unused.erase(unused.begin() + digits[i]);
+    }
+}
+
+// Exact optimal depth of every state, found by one breadth-first search backwards from the goal.
+// Unreachable states hold 255. The BFS visiting order (sorted by depth) is kept for depth sampling.
+vector<uint32_t> distance_table_bfs_order;
+vector<uint32_t> distance_table_depth_starts;   // Index of the first state at each depth in the order.
+
+const vector<uint8_t>& distance_table() {
+    static const vector<uint8_t> table = []() {
+        uint32_t states = 1;
+        for (int i = 2; i <= PUZZLE_TILES; i++) {
+            states *= i;
+        }
+        vector<uint8_t> depth(states, 255);
+        vector<uint32_t> &order = distance_table_bfs_order;
+        order.push_back(rank_tiles(goal_tiles().data()));
+        depth[order[0]] = 0;
+
+        uint8_t tiles[PUZZLE_TILES];
+        for (size_t head = 0; head < order.size(); head++) {
+            unrank_tiles(order[head], tiles);
+            int d = depth[order[head]];
+            if (distance_table_depth_starts.size() <= (size_t)d) {
+                distance_table_depth_starts.push_back(head);
+            }
+            int blank = find(tiles, tiles + PUZZLE_TILES, 0) - tiles;
+            for (int m = 0; m < 4; m++) {
+                int cell = BOARD.neighbour[blank][m];
+                if (cell < 0) {
+                    continue;
+                }
+                swap(tiles[blank], tiles[cell]);
+                uint32_t r = rank_tiles(tiles);
+                if (depth[r] == 255) {
+                    depth[r] = d + 1;
+                    order.push_back(r);
+                }
+                swap(tiles[blank], tiles[cell]);
+            }
+        }
+        distance_table_depth_starts.push_back(order.size());
+        return depth;
+    }();
+    return table;
+}
+
+// Exact depths for boards of 10 to 12 tiles (2x5, 3x4, 2x6), where a byte per arrangement would not fit.
+// A solvable state is numbered by the blank's cell and the order of the other tiles; of two orders that
+// only differ in their last two tiles exactly one is solvable, so leaving that choice out keeps the index
+// dense. Each state holds its depth modulo 3 in 2 bits (3 = not reached), from a layered breadth-first
+// search backwards from the goal; see exact_depth() for getting the depth back. 3x4 takes 60 MB.
+uint64_t packed_depth_orders() {    // Orders of the other tiles per blank cell: (tiles-1)!/2.
+    uint64_t orders = 1;
+    for (int i = 3; i < PUZZLE_TILES; i++) {
+        orders *= i;
+    }
+    return orders;
+}
+
+uint64_t packed_depth_index(const uint8_t* _tiles) {
+    uint32_t unused = (1u << min(PUZZLE_TILES, 31)) - 2;  // Tiles 1 to n-1 (only used for up to 12 tiles).
+    uint64_t rank = 0;
+    int blank = 0, placed = 0;
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        if (_tiles[i] == 0) {
+            blank = i;
+            continue;
+        }
+        rank = rank * (PUZZLE_TILES - 1 - placed++) + __builtin_popcount(unused & ((1u << _tiles[i]) - 1));
+        unused &= ~(1u << _tiles[i]);
+    }
+    return blank * packed_depth_orders() + rank / 2;    // The last digit but one is the dropped choice.
+}
+
+// Built once on first use with every hardware thread. Layers hold boards packed 4 bits per cell like
+// pack_puzzle(), so expanding a state needs no unranking; workers take chunks of the layer and claim new
+// states with a compare-and-swap, as in build_pattern_database().
+const vector<uint8_t>& packed_depth_table() {
+    static const vector<uint8_t> table = []() {
+        const uint64_t states = PUZZLE_TILES * packed_depth_orders(), CHUNK = 1 << 14;
+        const int threads = max(1u, thread::hardware_concurrency());
+        unique_ptr<atomic<uint8_t>[]> entries(new atomic<uint8_t>[(states + 3) / 4]);
+        for (uint64_t i = 0; i < (states + 3) / 4; i++) {
+            entries[i].store(0xff, memory_order_relaxed);
+        }
+        auto try_set = [&](uint64_t _state, int _value) {   // Sets an unseen state; false if it was seen already.
+            atomic<uint8_t> &byte = entries[_state / 4];
+            int shift = 2 * (_state & 3);
+            uint8_t old = byte.load(memory_order_relaxed);
+            while (((old >> shift) & 3) == 3) {
+                if (byte.compare_exchange_weak(old, old ^ ((3 ^ _value) << shift), memory_order_relaxed)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        vector<uint64_t> layer = {pack_puzzle(PUZZLE_GOAL)}, next;
+        try_set(packed_depth_index(goal_tiles().data()), 0);
+        mutex next_lock;
+        for (int depth = 0; !layer.empty(); depth++) {
+            atomic<uint64_t> next_chunk(0);
+            auto work = [&]() {
+                uint8_t tiles[PUZZLE_TILES];
+                vector<uint64_t> found;
+                for (uint64_t begin; (begin = next_chunk.fetch_add(CHUNK)) < layer.size(); ) {
+                    for (uint64_t n = begin; n < min((uint64_t)layer.size(), begin + CHUNK); n++) {
+                        int blank = 0;
+                        for (int i = 0; i < PUZZLE_TILES; i++) {
+                            tiles[i] = (layer[n] >> (4 * i)) & 0xf;
+                            blank = tiles[i] == 0 ? i : blank;
+                        }
+                        for (int m = 0; m < 4; m++) {
+                            int cell = BOARD.neighbour[blank][m];
+                            if (cell < 0) {
+                                continue;
+                            }
+                            swap(tiles[blank], tiles[cell]);
+                            if (try_set(packed_depth_index(tiles), (depth + 1) % 3)) {
+                                uint64_t tile = tiles[blank];
+                                found.push_back(layer[n] ^ (tile << (4 * cell)) ^ (tile << (4 * blank)));
+                            }
+                            swap(tiles[blank], tiles[cell]);
+                        }
+                    }
+                }
+                lock_guard<mutex> guard(next_lock);
+                next.insert(next.end(), found.begin(), found.end());
+            };
+            vector<thread> workers;
+            for (int t = 1; t < threads; t++) {
+                workers.emplace_back(work);
+            }
+            work();
+            for (thread &worker : workers) {
+                worker.join();
+            }
+            layer.swap(next);
+            next.clear();
+        }
+
+        vector<uint8_t> depth_mod3((states + 3) / 4);
+        for (uint64_t i = 0; i < depth_mod3.size(); i++) {
+            depth_mod3[i] = entries[i].load(memory_order_relaxed);
+        }
+        return depth_mod3;
+    }();
+    return table;
+}
+
+// Exact optimal depth of a board, or -1 if it is unsolvable or too large for a table: one lookup in the
+// distance table up to 9 tiles, and up to 12 a walk to the goal through the packed table. A neighbour is
+// one move nearer or further, and those differ modulo 3, so the neighbour one lower modulo 3 is exactly
+// one nearer; each step costs at most 4 lookups. Tables are built on first use.
+int exact_depth(const uint8_t* _tiles) {
+    if (PUZZLE_TILES <= 9) {
+        return (int8_t)distance_table()[rank_tiles(_tiles)];
+    }
+    if (PUZZLE_TILES > 12 || !is_solvable_tiles(_tiles)) {
+        return -1;
+    }
+    const vector<uint8_t> &table = packed_depth_table();
+    auto mod3 = [&](uint64_t _state) { return (table[_state / 4] >> (2 * (_state & 3))) & 3; };
+    uint8_t tiles[PUZZLE_TILES];
+    copy(_tiles, _tiles + PUZZLE_TILES, tiles);
+    int blank = find(tiles, tiles + PUZZLE_TILES, 0) - tiles, depth = 0;
+    uint64_t state = packed_depth_index(tiles);
+    while (!equal(tiles, tiles + PUZZLE_TILES, goal_tiles().begin())) {
+        int lower = (mod3(state) + 2) % 3;
+        bool stepped = false;
+        for (int m = 0; m < 4 && !stepped; m++) {
+            int cell = BOARD.neighbour[blank][m];
+            if (cell < 0) {
+                continue;
+            }
+            swap(tiles[blank], tiles[cell]);
+            uint64_t child = packed_depth_index(tiles);
+            stepped = mod3(child) == lower;
+            if (stepped) {
+                blank = cell;
+                state = child;
+            } else {
+                swap(tiles[blank], tiles[cell]);
+            }
+        }
+        if (!stepped) {
+            return -1;  // Only if the table is corrupt.
+        }
+        depth++;
+    }
+    return depth;
+}
+
+// Whether the tiles can reach the standard goal, by the parity rule for the board's width.
+bool is_solvable_tiles(const uint8_t* _tiles) {
+    return BOARD.solvable(_tiles);
+}
+
+// Mixes a seed so that neighbouring block numbers give unrelated random streams.
+uint64_t splitmix64(uint64_t _x) {
+    _x += 0x9e3779b97f4a7c15ULL;
+    _x = (_x ^ (_x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    _x = (_x ^ (_x >> 27)) * 0x94d049bb133111ebULL;
+    return _x ^ (_x >> 31);
+}
+
+struct GeneratorOptions {
+    string mode = "uniform";    // "uniform", "walk" or "depth".
+    long long count = 1000;
+    uint64_t seed = 1;
+    int walk_length = 50;       // Moves per random walk ("walk" mode).
+    int depth = 20;             // Exact optimal depth to sample at ("depth" mode, 9 tiles or fewer only).
+    int threads = max(1u, thread::hardware_concurrency());
+    string output_path;         // Empty writes to standard output.
+    bool binary = false;
+};
+
+// Fills one block of instances. Every block has its own seed, so the output only depends on the seed and
+// not on how many threads were used. Each instance is its optimal depth (-1 if unknown) and its tiles.
+void generate_block(GeneratorOptions &_options, long long _block, long long _first, long long _last, vector<int8_t> &_depths, vector<uint8_t> &_tiles) {
+    mt19937_64 rng(splitmix64(_options.seed ^ splitmix64(_block)));
+    const bool certified = PUZZLE_TILES <= 12;     // Whether exact_depth() has a table for this shape.
+
+    // Legal moves for every blank position and previous move (4 = none), never undoing the previous move.
+    // Moves come in opposite pairs, 0/1 and 2/3, so the reverse of move m is m^1.
+    // Each entry stores the move and the blank's new position.
+    struct WalkMoves { int count = 0; int move[4]; int next_blank[4]; };
+    vector<WalkMoves> walk_moves(PUZZLE_TILES * 5);
+    for (int blank = 0; blank < PUZZLE_TILES; blank++) {
+        for (int last_move = 0; last_move <= 4; last_move++) {
+            WalkMoves &entry = walk_moves[blank * 5 + last_move];
+            for (int m = 0; m < 4; m++) {
+                if (BOARD.neighbour[blank][m] >= 0 && m != (last_move ^ 1)) {
+                    entry.move[entry.count] = m;
+                    entry.next_blank[entry.count++] = BOARD.neighbour[blank][m];
+                }
+            }
+        }
+    }
+
+    for (long long n = _first; n < _last; n++) {
+        uint8_t* tiles = &_tiles[n * PUZZLE_TILES];
+        if (_options.mode == "depth") {     // Picks uniformly among all states at exactly this depth.
+            uint32_t first = distance_table_depth_starts[_options.depth];
+            uint32_t count = distance_table_depth_starts[_options.depth+1] - first;
+            unrank_tiles(distance_table_bfs_order[first + rng() % count], tiles);
+        } else if (_options.mode == "walk") {   // Random moves from the goal, never undoing the last move.
+            copy(goal_tiles().begin(), goal_tiles().end(), tiles);
+            int blank = find(tiles, tiles + PUZZLE_TILES, 0) - tiles;
+            int last_move = 4;
+            uint64_t bits = 0;
+            for (int step = 0; step < _options.walk_length; step++) {
+                if (step % 4 == 0) {
+                    bits = rng();   // One 64-bit draw covers four steps (16 bits each).
+                }
+                const WalkMoves &moves = walk_moves[blank * 5 + last_move];
+                int pick = ((bits & 0xffff) * moves.count) >> 16;
+                bits >>= 16;
+                last_move = moves.move[pick];
+                swap(tiles[blank], tiles[moves.next_blank[pick]]);
+                blank = moves.next_blank[pick];
+            }
+        } else {    // Uniform over solvable states: a shuffle, fixed up by swapping two tiles if unsolvable.
+            for (int i = 0; i < PUZZLE_TILES; i++) {
+                tiles[i] = i;
+            }
+            for (int i = PUZZLE_TILES-1; i > 0; i--) {
+                swap(tiles[i], tiles[rng() % (i+1)]);
+            }
+            if (!is_solvable_tiles(tiles)) {
+                int a = (tiles[0] == 0) ? 2 : 0, b = (tiles[1] == 0) ? 2 : 1;
+                swap(tiles[a], tiles[b]);
+            }
+        }
+        _depths[n] = certified ? exact_depth(tiles) : -1;
+    }
+}
+
+// Handles "--generate MODE COUNT [--seed S] [--length L] [--depth D] [--threads T] [--output FILE] [--binary]".
+int run_generator(int argc, char* argv[]) {
+    GeneratorOptions options;
+    if (argc > 2) {
+        options.mode = argv[2];
+    }
+    if (argc > 3) {
+        options.count = atoll(argv[3]);
+    }
+    for (int i = 4; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--binary") {
+            options.binary = true;
+        } else if (i+1 < argc && flag == "--seed") {
+            options.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (i+1 < argc && flag == "--length") {
+            options.walk_length = atoi(argv[++i]);
+        } else if (i+1 < argc && flag == "--depth") {
+            options.depth = atoi(argv[++i]);
+        } else if (i+1 < argc && flag == "--threads") {
+            options.threads = max(1, atoi(argv[++i]));
+        } else if (i+1 < argc && flag == "--output") {
+            options.output_path = argv[++i];
+        }
+    }
+
+    if (!(options.mode == "uniform" || options.mode == "walk" || options.mode == "depth") || options.count < 0) {
+        cerr << "Usage: --generate uniform|walk|depth COUNT [--seed S] [--length L] [--depth D] "
+             << "[--threads T] [--output FILE] [--binary]" << '\n';
+        return 1;
+    }
+    if (PUZZLE_TILES <= 12) {
+        exact_depth(goal_tiles().data());   // Builds the table once up front; the worker threads only read it.
+    }
+    if (options.mode == "depth") {
+        if (PUZZLE_TILES > 9 || options.depth < 0 || options.depth+1 >= (int)distance_table_depth_starts.size()) {
+            cerr << "No states exist at depth " << options.depth << " for this puzzle size." << '\n';
+            return 1;
+        }
+    }
+
+    // Blocks are handed out to the threads through a shared counter.
+    const long long BLOCK_SIZE = 4096;
+    long long blocks = (options.count + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    vector<int8_t> depths(options.count);
+    vector<uint8_t> tiles(options.count * PUZZLE_TILES);
+    atomic<long long> next_block(0);
+    vector<thread> workers;
+    for (int t = 0; t < options.threads; t++) {
+        workers.emplace_back([&]() {
+            for (long long b = next_block++; b < blocks; b = next_block++) {
+                generate_block(options, b, b * BLOCK_SIZE, min(options.count, (b+1) * BLOCK_SIZE), depths, tiles);
+            }
+        });
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+
+    FILE* out = options.output_path.empty() ? stdout : fopen(options.output_path.c_str(), options.binary ? "wb" : "w");
+    if (out == nullptr) {
+        cerr << "Unable to open \"" << options.output_path << "\" for writing." << '\n';
+        return 1;
+    }
+    if (options.binary) {   // "NPZGEN1", shape, count, then per instance one depth byte and the tiles.
+        int32_t shape = PUZZLE_SHAPE;
+        int64_t count = options.count;
+        fwrite("NPZGEN1", 1, 7, out);
+        fwrite(&shape, sizeof(shape), 1, out);
+        fwrite(&count, sizeof(count), 1, out);
+        for (long long n = 0; n < options.count; n++) {
+            fwrite(&depths[n], 1, 1, out);
+            fwrite(&tiles[n * PUZZLE_TILES], 1, PUZZLE_TILES, out);
+        }
+    } else {    // One instance per line: the depth followed by the tiles in row-major order.
+        string line;
+        for (long long n = 0; n < options.count; n++) {
+            line = to_string(depths[n]);
+            for (int i = 0; i < PUZZLE_TILES; i++) {
+                line += ' ';
+                line += to_string(tiles[n * PUZZLE_TILES + i]);
+            }
+            line += '\n';
+            fwrite(line.data(), 1, line.size(), out);
+        }
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
+
+
+// The solve service reads one request per line and answers each with one line, tagged with the request's id
+// so pipelined requests may be answered out of order:
+//   request:  ID ALGORITHM TILE... [WEIGHT] [GOAL_TILE...]   (ALGORITHM is the number from the interactive menu)
+//   replies:  ID OK DEPTH NODES MOVES | ID STOPPED REASON LOWER_BOUND NODES | ID UNSOLVABLE | ID BUSY | ID ERROR MESSAGE
+struct ServerJob {
+    uint64_t connection_id;
+    string request_id;
+    vector<vector<int>> puzzle;
+    string heuristic_type;
+    double weight;
+    vector<vector<int>> goal;   // Empty for the standard goal.
+};
+
+struct ServerConnection {
+    int fd;
+    uint64_t id;
+    string in, out;     // Unparsed request bytes and unsent reply bytes.
+    size_t scanned = 0;     // Bytes of `in` already searched for a newline.
+    int pending = 0;    // Queued or running requests still owed a reply.
+    bool peer_closed = false;   // The client stopped sending; the socket closes once every reply is sent.
+};
+
+// Shared between the event loop and the solver threads. Replies travel back through `replies` and an
+// eventfd wakes the event loop, so only the event loop ever touches the sockets.
+struct ServerQueue {
+    mutex lock;
+    condition_variable job_ready;
+    deque<ServerJob> jobs;
+    size_t max_jobs = 256;
+    vector<pair<uint64_t, string>> replies;
+    int wake_fd = -1;
+    bool shutting_down = false;
+};
+
+// Parses one request line. Invalid or unsolvable requests and requests arriving while the queue is full
+// are answered right away; everything else is queued for the solver threads.
+void handle_request(ServerQueue &_queue, ServerConnection &_connection, string _line, SearchOptions &_options) {
+    istringstream in(_line);
+    string request_id;
+    int algorithm_type = 0;
+    if (!(in >> request_id)) {
+        return;     // Blank line.
+    }
+    ServerJob job = {_connection.id, request_id, vector<vector<int>>(PUZZLE_ROWS, vector<int>(PUZZLE_COLS)), "",
+                     _options.weight, _options.goal};
+
+    // Reads PUZZLE_TILES values into a board, checking that they are a permutation of the tiles.
+    auto read_board = [](vector<double> &_values, size_t _first, vector<vector<int>> &_board) {
+        vector<bool> seen(PUZZLE_TILES, false);
+        _board.assign(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+        for (int i = 0; i < PUZZLE_TILES; i++) {
+            int tile = (int)_values[_first + i];
+            if (tile != _values[_first + i] || tile < 0 || tile >= PUZZLE_TILES || seen[tile]) {
+                return false;
+            }
+            seen[tile] = true;
+            _board[i / PUZZLE_COLS][i % PUZZLE_COLS] = tile;
+        }
+        return true;
+    };
+    vector<double> values;
+    double value;
+    bool valid = (bool)(in >> algorithm_type);
+    while (in >> value) {
+        values.push_back(value);
+    }
+    // After the tiles come an optional weight and an optional goal, told apart by how many values are left.
+    size_t extra = values.size() >= (size_t)PUZZLE_TILES ? values.size() - PUZZLE_TILES : 0;
+    valid = valid && values.size() >= (size_t)PUZZLE_TILES && read_board(values, 0, job.puzzle)
+          && (extra == 0 || extra == 1 || extra == (size_t)PUZZLE_TILES || extra == (size_t)PUZZLE_TILES+1);
+    if (valid && extra % PUZZLE_TILES == 1) {
+        job.weight = values[PUZZLE_TILES];
+    }
+    if (valid && extra >= (size_t)PUZZLE_TILES) {
+        valid = read_board(values, PUZZLE_TILES + extra % PUZZLE_TILES, job.goal);
+    }
+    job.heuristic_type = heuristic_type_for_algorithm(algorithm_type);
+    if (!valid || job.heuristic_type.empty() || job.weight < 1.0) {
+        _connection.out += request_id + " ERROR expected: ID ALGORITHM TILE... [WEIGHT] [GOAL_TILE...]\n";
+        return;
+    }
+    vector<vector<int>> goal = job.goal.empty() ? PUZZLE_GOAL : job.goal;
+    if (!is_solvable_for_goal(job.puzzle, goal)) {
+        _connection.out += request_id + " UNSOLVABLE\n";
+        return;
+    }
+
+    lock_guard<mutex> guard(_queue.lock);
+    if (_queue.jobs.size() >= _queue.max_jobs) {
+        _connection.out += request_id + " BUSY\n";  // Backpressure: the client should retry later.
+        return;
+    }
+    _queue.jobs.push_back(job);
+    _connection.pending++;
+    _queue.job_ready.notify_one();
+}
+
+void solver_thread(ServerQueue &_queue, SearchOptions _options) {
+    SearchContext context;  // Reused for every request this thread solves.
+    while (true) {
+        ServerJob job;
+        {
+            unique_lock<mutex> guard(_queue.lock);
+            _queue.job_ready.wait(guard, [&]() { return _queue.shutting_down || !_queue.jobs.empty(); });
+            if (_queue.shutting_down) {
+                return;
+            }
+            job = _queue.jobs.front();
+            _queue.jobs.pop_front();
+        }
+
+        SearchOptions options = _options;
+        options.weight = job.weight;
+        options.goal = job.goal;
+        SearchResult result = context.solve(job.puzzle, job.heuristic_type, options);
+
+        string reply = job.request_id;
+        if (result.solved) {
+            reply += " OK " + to_string(result.depth) + " " + to_string(result.nodes_expanded) + " "
+                   + (result.moves.empty() ? "-" : result.moves);
+        } else if (!result.stop_reason.empty()) {
+            string reason = result.stop_reason;
+            replace(reason.begin(), reason.end(), ' ', '_');
+            reply += " STOPPED " + reason + " " + to_string(result.lower_bound) + " " + to_string(result.nodes_expanded);
+        } else {
+            reply += " UNSOLVABLE";
+        }
+
+        {
+            lock_guard<mutex> guard(_queue.lock);
+            _queue.replies.emplace_back(job.connection_id, reply + "\n");
+        }
+        uint64_t one = 1;
+        if (write(_queue.wake_fd, &one, sizeof(one)) < 0) {
+            // The counter is already non-zero, so the event loop will wake up anyway.
+        }
+    }
+}
+
+// Handles "--serve PATH" (Unix domain socket) or "--serve-tcp PORT" (localhost only), with optional
+// "--workers N" and "--queue-size N" plus the usual search flags, which apply to every request.
+int run_server(int argc, char* argv[]) {
+    SearchOptions options;
+    if (!parse_search_flags(argc, argv, options)) {
+        return 1;
+    }
+    options.verbose = false;
+    options.checkpoint_path.clear();
+    options.resume_path.clear();
+    options.cancel_token = &interrupt_requested;    // Shutting down stops the searches still running.
+    signal(SIGINT, [](int) { interrupt_requested.store(true); });
+    signal(SIGTERM, [](int) { interrupt_requested.store(true); });
+    signal(SIGPIPE, SIG_IGN);
+
+    ServerQueue queue;
+    int workers = max(1u, thread::hardware_concurrency());
+    for (int i = 3; i+1 < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--workers") {
+            workers = max(1, atoi(argv[++i]));
+        } else if (flag == "--queue-size") {
+            queue.max_jobs = max(1, atoi(argv[++i]));
+        }
+    }
+    if (argc < 3) {
+        cerr << "Usage: --serve PATH | --serve-tcp PORT [--workers N] [--queue-size N]" << '\n';
+        return 1;
+    }
+
+    int listen_fd;
+    if (string(argv[1]) == "--serve") {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, argv[2], sizeof(address.sun_path) - 1);
+        unlink(argv[2]);    // Removes a socket file left behind by an earlier run.
+        listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0) {
+            perror("bind");
+            return 1;
+        }
+    } else {
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(atoi(argv[2]));
+        listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        int reuse = 1;
+        setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (listen_fd < 0 || bind(listen_fd, (sockaddr*)&address, sizeof(address)) < 0) {
+            perror("bind");
+            return 1;
+        }
+    }
+    if (listen(listen_fd, 128) < 0) {
+        perror("listen");
+        return 1;
+    }
+
+    int epoll_fd = epoll_create1(0);
+    queue.wake_fd = eventfd(0, EFD_NONBLOCK);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    event.data.fd = queue.wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, queue.wake_fd, &event);
+
+    vector<thread> solvers;
+    for (int i = 0; i < workers; i++) {
+        solvers.emplace_back(solver_thread, ref(queue), options);
+    }
+    cerr << "Serving on " << argv[2] << " with " << workers << " solver threads." << '\n';
+
+    map<int, ServerConnection> connections;     // By socket.
+    map<uint64_t, int> connection_sockets;      // By connection id, which unlike sockets is never reused.
+    uint64_t next_connection_id = 0;
+
+    // Sends as much pending output as the socket takes and only asks for EPOLLOUT while some is left.
+    auto flush = [&](ServerConnection &_connection) {
+        while (!_connection.out.empty()) {
+            ssize_t sent = write(_connection.fd, _connection.out.data(), _connection.out.size());
+            if (sent <= 0) {
+                break;
+            }
+            _connection.out.erase(0, sent);
+        }
+        epoll_event update = {};
+        update.events = (_connection.peer_closed ? 0u : (uint32_t)(EPOLLIN | EPOLLRDHUP)) | (_connection.out.empty() ? 0u : (uint32_t)EPOLLOUT);
+        update.data.fd = _connection.fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, _connection.fd, &update);
+    };
+    auto close_connection = [&](int _fd) {
+        connection_sockets.erase(connections[_fd].id);
+        connections.erase(_fd);
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, _fd, nullptr);
+        close(_fd);     // Replies for its unfinished requests are dropped when they arrive.
+    };
+
+    const int MAX_EVENTS = 64;
+    const size_t MAX_LINE = 4096;   // Far more than any valid request needs.
+    epoll_event events[MAX_EVENTS];
+    while (!interrupt_requested.load()) {
+        int ready = epoll_wait(epoll_fd, events, MAX_EVENTS, 200);   // Wakes up regularly to notice shutdown.
+        for (int e = 0; e < ready; e++) {
+            int fd = events[e].data.fd;
+            if (fd == listen_fd) {
+                int client_fd;
+                while ((client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+                    connections[client_fd] = {client_fd, next_connection_id, "", ""};
+                    connection_sockets[next_connection_id++] = client_fd;
+                    epoll_event client_event = {};
+                    client_event.events = EPOLLIN | EPOLLRDHUP;
+                    client_event.data.fd = client_fd;
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_fd, &client_event);
+                }
+            } else if (fd == queue.wake_fd) {
+                uint64_t count;
+                if (read(queue.wake_fd, &count, sizeof(count)) < 0) {
+                    continue;
+                }
+                vector<pair<uint64_t, string>> replies;
+                {
+                    lock_guard<mutex> guard(queue.lock);
+                    replies.swap(queue.replies);
+                }
+                for (auto &reply : replies) {
+                    auto it = connection_sockets.find(reply.first);
+                    if (it != connection_sockets.end()) {
+                        ServerConnection &connection = connections[it->second];
+                        connection.out += reply.second;
+                        connection.pending--;
+                        flush(connection);
+                        if (connection.peer_closed && connection.pending == 0 && connection.out.empty()) {
+                            close_connection(connection.fd);
+                        }
+                    }
+                }
+            } else if (connections.count(fd)) {
+                ServerConnection &connection = connections[fd];
+                if (events[e].events & (EPOLLHUP | EPOLLERR)) {
+                    close_connection(fd);   // Nothing more can be sent either.
+                    continue;
+                }
+                if (!connection.peer_closed && (events[e].events & (EPOLLIN | EPOLLRDHUP))) {
+                    char buffer[4096];
+                    ssize_t received;
+                    bool too_long = false;
+                    while (!too_long && (received = read(fd, buffer, sizeof(buffer))) > 0) {
+                        connection.in.append(buffer, received);
+                        size_t line_end;
+                        while ((line_end = connection.in.find('\n', connection.scanned)) != string::npos) {
+                            handle_request(queue, connection, connection.in.substr(0, line_end), options);
+                            connection.in.erase(0, line_end + 1);
+                            connection.scanned = 0;
+                        }
+                        connection.scanned = connection.in.size();
+                        too_long = connection.in.size() > MAX_LINE;
+                    }
+                    if (too_long) {     // Stops reading; the connection closes once the earlier replies are sent.
+                        connection.out += "- ERROR request line longer than " + to_string(MAX_LINE) + " bytes\n";
+                        connection.in.clear();
+                        while (read(fd, buffer, sizeof(buffer)) > 0) {
+                            // Drops what is already buffered, since closing with unread input resets the connection.
+                        }
+                        connection.peer_closed = true;
+                    } else {
+                        connection.peer_closed = received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+                    }
+                }
+                flush(connection);
+                if (connection.peer_closed && connection.pending == 0 && connection.out.empty()) {
+                    close_connection(fd);
+                }
+            }
+        }
+    }
+
+    {
+        lock_guard<mutex> guard(queue.lock);
+        queue.shutting_down = true;
+    }
+    queue.job_ready.notify_all();
+    for (thread &solver : solvers) {
+        solver.join();
+    }
+    for (auto &entry : connections) {
+        close(entry.first);
+    }
+    close(listen_fd);
+    close(queue.wake_fd);
+    close(epoll_fd);
+    if (string(argv[1]) == "--serve") {
+        unlink(argv[2]);
+    }
+    return 0;
+}
+
+
+// Conditional distribution prediction (CDP) of how many nodes IDA* expands, without searching. Nodes are
+// grouped into types by their heuristic value, their parent's heuristic value and the blank's cell. A long
+// random walk samples, for every type, the expected number of children of each type, leaving out the move
+// straight back. A prediction starts from the root's actual children and carries fractional node counts
+// per type down the tree, level by level, expanding only those within the threshold. It only touches the
+// types that can occur, so it takes microseconds. What it predicts is the tree with moves straight back
+// pruned; the transposition table and the move-pruning automaton make IDA*'s real tree smaller.
+struct CdpModel {
+    string heuristic_type;
+    long long samples = 0;
+    vector<vector<pair<int, double>>> children;     // Type -> (child type, expected number per node).
+
+    // The parent's heuristic value is stored relative to the node's, clamped to one step either way.
+    static int type_of(int _h, int _parent_h, int _blank) {
+        int step = max(-1, min(1, _parent_h - _h)) + 1;
+        return (_h * 3 + step) * PUZZLE_TILES + _blank;
+    }
+
+    static int h_of(int _type) {
+        return _type / (3 * PUZZLE_TILES);
+    }
+};
+
+// Samples the type system along a random walk of _samples moves that never moves straight back. It starts
+// from a uniformly random solvable board, so it needs no burn-in.
+CdpModel sample_cdp_model(string _heuristic_type, long long _samples, unsigned _seed) {
+    mt19937 rng(_seed);
+    uint8_t tiles[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        tiles[i] = i;
+    }
+    shuffle(tiles, tiles + PUZZLE_TILES, rng);
+    if (!is_solvable_tiles(tiles)) {    // Swapping two tiles flips the parity.
+        int a = (tiles[0] == 0) ? 1 : 0, b = (tiles[a+1] == 0) ? a+2 : a+1;
+        swap(tiles[a], tiles[b]);
+    }
+    vector<vector<int>> puzzle(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        puzzle[i / PUZZLE_COLS][i % PUZZLE_COLS] = tiles[i];
+    }
+    int x_blank, y_blank;
+    locate_blank(puzzle, x_blank, y_blank);
+    int blank = x_blank * PUZZLE_COLS + y_blank, parent_blank = -1;
+    int h = compute_heuristic(puzzle, _heuristic_type), parent_h = h;
+
+    vector<long long> occurrences;
+    vector<unordered_map<int, long long>> counts;   // Type -> child type -> children seen.
+    for (long long sample = 0; sample <= _samples; sample++) {
+        int type = CdpModel::type_of(h, parent_h, blank);
+        if (sample > 0 && type >= (int)occurrences.size()) {   // The root has no parent, so it is not a sample.
+            occurrences.resize(type + 1, 0);
+            counts.resize(type + 1);
+        }
+        if (sample > 0) {
+            occurrences[type]++;
+        }
+        int children = 0, child_blanks[4], child_hs[4];
+        for (int m = 0; m < 4; m++) {
+            int new_blank = BOARD.neighbour[blank][m];
+            if (new_blank < 0 || new_blank == parent_blank) {
+                continue;   // Off the board, or straight back.
+            }
+            int new_x_blank = new_blank / PUZZLE_COLS, new_y_blank = new_blank % PUZZLE_COLS;
+            swap(puzzle[blank / PUZZLE_COLS][blank % PUZZLE_COLS], puzzle[new_x_blank][new_y_blank]);
+            int child_h = compute_heuristic(puzzle, _heuristic_type);
+            swap(puzzle[blank / PUZZLE_COLS][blank % PUZZLE_COLS], puzzle[new_x_blank][new_y_blank]);
+            if (sample > 0) {
+                counts[type][CdpModel::type_of(child_h, h, new_blank)]++;
+            }
+            child_blanks[children] = new_blank;
+            child_hs[children++] = child_h;
+        }
+
+        int c = rng() % children;   // Every cell has at least two neighbours, so there is always a move.
+        swap(puzzle[blank / PUZZLE_COLS][blank % PUZZLE_COLS],
+             puzzle[child_blanks[c] / PUZZLE_COLS][child_blanks[c] % PUZZLE_COLS]);
+        parent_blank = blank;
+        parent_h = h;
+        blank = child_blanks[c];
+        h = child_hs[c];
+    }
+
+    CdpModel model;
+    model.heuristic_type = _heuristic_type;
+    model.samples = _samples;
+    model.children.resize(occurrences.size());
+    for (size_t type = 0; type < occurrences.size(); type++) {
+        for (auto &child : counts[type]) {
+            model.children[type].push_back({child.first, (double)child.second / occurrences[type]});
+        }
+    }
+    return model;
+}
+
+// Predicted number of nodes IDA* expands in its iteration with the given threshold. Types the walk never
+// reached are counted when expanded but contribute no children.
+double predict_ida_star_iteration(const CdpModel &_model, vector<vector<int>> &_p, int _threshold) {
+    string heuristic_type = _model.heuristic_type;
+    int root_h = compute_heuristic(_p, heuristic_type);
+    if (root_h > _threshold) {
+        return 0;
+    }
+    int x_blank, y_blank;
+    locate_blank(_p, x_blank, y_blank);
+
+    // The root's children are generated for real; each level after that comes from the model.
+    size_t types = _model.children.size();
+    vector<double> level(types, 0), next_level(types, 0);
+    vector<int> active, next_active;
+    double expanded = 1;
+    for (int m = 0; m < 4; m++) {
+        int new_blank = BOARD.neighbour[x_blank * PUZZLE_COLS + y_blank][m];
+        if (new_blank < 0) {
+            continue;
+        }
+        int new_x_blank = new_blank / PUZZLE_COLS, new_y_blank = new_blank % PUZZLE_COLS;
+        swap(_p[x_blank][y_blank], _p[new_x_blank][new_y_blank]);
+        int child_h = compute_heuristic(_p, heuristic_type);
+        swap(_p[x_blank][y_blank], _p[new_x_blank][new_y_blank]);
+        int type = CdpModel::type_of(child_h, root_h, new_blank);
+        if (1 + child_h > _threshold) {
+            continue;
+        } else if ((size_t)type >= types) {
+            expanded++;
+            continue;
+        }
+        if (level[type] == 0) {
+            active.push_back(type);
+        }
+        level[type]++;
+    }
+
+    for (int g = 1; !active.empty(); g++) {
+        next_active.clear();
+        for (int type : active) {
+            double nodes = level[type];
+            level[type] = 0;
+            expanded += nodes;
+            for (const pair<int, double> &child : _model.children[type]) {
+                if (g + 1 + CdpModel::h_of(child.first) > _threshold) {
+                    continue;   // Generated, but not expanded.
+                } else if ((size_t)child.first >= types) {
+                    expanded += nodes * child.second;
+                    continue;
+                }
+                if (next_level[child.first] == 0) {
+                    next_active.push_back(child.first);
+                }
+                next_level[child.first] += nodes * child.second;
+            }
+        }
+        swap(level, next_level);
+        swap(active, next_active);
+    }
+    return expanded;
+}
+
+// Predicted expansions of a whole IDA* run that ends with the given threshold: the sum over its iterations.
+// The thresholds go up from the root's heuristic value; one that changes nothing (an f value no node can
+// have, such as those of the wrong parity under Manhattan distance) is not an iteration IDA* would run.
+double predict_ida_star_expansions(const CdpModel &_model, vector<vector<int>> &_p, int _final_threshold) {
+    string heuristic_type = _model.heuristic_type;
+    int root_h = compute_heuristic(_p, heuristic_type);
+    double total = 0, previous = -1;
+    for (int threshold = root_h; threshold <= _final_threshold; threshold++) {
+        double iteration = predict_ida_star_iteration(_model, _p, threshold);
+        if (iteration != previous) {
+            total += iteration;
+        }
+        previous = iteration;
+    }
+    return total;
+}
+
+// Guesses the optimal depth when it is not known: it has the same parity as the Manhattan distance and
+// typically sits about 30% above it.
+int estimate_solution_depth(vector<vector<int>> &_p) {
+    int manhattan = manhattan_distance(_p);
+    int estimated_depth = (int)round(manhattan * 1.3);
+    if ((estimated_depth - manhattan) % 2 != 0) {
+        estimated_depth++;
+    }
+    return estimated_depth;
+}
+
+// Rough number of nodes a search will expand, used to order batch jobs. The search has to work through
+// every f layer between the root's heuristic value and the optimal depth, which is estimated unless given.
+// Without a model each layer is taken to be about 1.8 times bigger than the last; with one, IDA*'s
+// expansions are predicted. Unsolvable boards cost nothing since the parity check rejects them without a
+// search.
+double estimate_job_cost(vector<vector<int>> &_p, string &_heuristic_type, int _depth, const CdpModel* _model) {
+    uint8_t tiles[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        tiles[i] = _p[i / PUZZLE_COLS][i % PUZZLE_COLS];
+    }
+    if (!is_solvable_tiles(tiles)) {
+        return 0;
+    }
+    int depth = (_depth >= 0) ? _depth : estimate_solution_depth(_p);
+    if (_model != nullptr) {
+        return predict_ida_star_expansions(*_model, _p, depth);
+    }
+    return pow(1.8, depth - compute_heuristic(_p, _heuristic_type));
+}
+
+// Handles "--batch FILE [--algorithm N] [--workers N] [--fifo] [--lanes 8|16] [--cost-model cdp] [--cdp-samples N]"
+// plus the usual search flags. FILE holds one instance per line, either as the generator writes them (depth,
+// then tiles) or as tiles alone. Jobs are dispatched longest-expected-first so the expensive ones do not
+// start last and leave workers idle.
+int run_batch(int argc, char* argv[]) {
+    SearchOptions options;
+    if (!parse_search_flags(argc, argv, options)) {
+        return 1;
+    }
+    options.verbose = false;
+    options.checkpoint_path.clear();
+    options.resume_path.clear();
+    options.cancel_token = &interrupt_requested;
+    signal(SIGINT, [](int) { interrupt_requested.store(true); });
+    if (!options.trace_path.empty() && !start_expansion_trace(options.trace_path)) {
+        return 1;
+    }
+
+    int algorithm_type = 3, workers = max(1u, thread::hardware_concurrency()), lanes = 1;
+    bool fifo = false, cdp = false;
+    long long cdp_samples = 100000;
+    for (int i = 3; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--fifo") {
+            fifo = true;
+        } else if (i+1 < argc && flag == "--cost-model") {
+            cdp = string(argv[++i]) == "cdp";
+        } else if (i+1 < argc && flag == "--cdp-samples") {
+            cdp_samples = max(1LL, atoll(argv[++i]));
+        } else if (i+1 < argc && flag == "--algorithm") {
+            algorithm_type = atoi(argv[++i]);
+        } else if (i+1 < argc && flag == "--workers") {
+            workers = max(1, atoi(argv[++i]));
+        } else if (i+1 < argc && flag == "--lanes") {
+            lanes = atoi(argv[++i]);
+            lanes = (lanes <= 1) ? 1 : (lanes <= 8) ? 8 : 16;
+        }
+    }
+    string heuristic_type = heuristic_type_for_algorithm(algorithm_type);
+    if (heuristic_type.empty()) {
+        cerr << "Unknown algorithm " << algorithm_type << "." << '\n';
+        return 1;
+    }
+    if (lanes > 1 && (heuristic_type != "IDA* Manhattan" || PUZZLE_TILES > 16 || (!options.goal.empty() && options.goal != PUZZLE_GOAL))) {
+        cerr << "--lanes only applies to IDA* Manhattan (algorithm 9) towards the standard goal on boards of up to 16 tiles; "
+             << "solving one job at a time." << '\n';
+        lanes = 1;
+    }
+
+    ifstream in(argv[2]);
+    if (!in) {
+        cerr << "Unable to open \"" << argv[2] << "\"." << '\n';
+        return 1;
+    }
+
+    // The CDP model predicts IDA*'s tree for the algorithm's heuristic; for the other modes only the
+    // order it gives matters.
+    unique_ptr<CdpModel> cost_model;
+    double cost_model_ms = 0;
+    if (cdp) {
+        auto sample_start = chrono::steady_clock::now();
+        cost_model.reset(new CdpModel(sample_cdp_model(heuristic_type, cdp_samples, 1)));
+        chrono::duration<double, milli> sample_ms = chrono::steady_clock::now() - sample_start;
+        cost_model_ms = sample_ms.count();
+    }
+    vector<BatchJob> jobs;
+    string line;
+    while (getline(in, line)) {
+        istringstream numbers(line);
+        vector<int> values;
+        int value;
+        while (numbers >> value) {
+            values.push_back(value);
+        }
+        if ((int)values.size() != PUZZLE_TILES && (int)values.size() != PUZZLE_TILES+1) {
+            continue;   // Blank or malformed line.
+        }
+        int offset = values.size() - PUZZLE_TILES;
+        BatchJob job;
+        job.puzzle.assign(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+        for (int i = 0; i < PUZZLE_TILES; i++) {
+            job.puzzle[i / PUZZLE_COLS][i % PUZZLE_COLS] = values[offset + i];
+        }
+        vector<vector<int>> goal = options.goal.empty() ? PUZZLE_GOAL : options.goal;
+        job.solvable = is_solvable_for_goal(job.puzzle, goal);
+        GoalMapping mapping;
+        vector<vector<int>> estimated = map_goal(goal, mapping) ? apply_goal_mapping(mapping, job.puzzle) : job.puzzle;
+        int known_depth = (offset > 0 && options.goal.empty()) ? values[0] : -1;    // The generator's depth, if any.
+        job.estimated_cost = job.solvable ? estimate_job_cost(estimated, heuristic_type, known_depth, cost_model.get()) : 0;
+        jobs.push_back(job);
+    }
+
+    vector<int> order(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        order[i] = i;
+    }
+    if (!fifo) {
+        stable_sort(order.begin(), order.end(), [&](int a, int b) { return jobs[a].estimated_cost > jobs[b].estimated_cost; });
+    }
+
+    // IDA* builds its move-pruning automaton on first use; build it here so the first job's run time and
+    // the makespan measure solving only.
+    double automaton_ms = 0;
+    if (lanes == 1 && heuristic_type.compare(0, 4, "IDA*") == 0 && options.move_pruning) {
+        auto build_start = chrono::steady_clock::now();
+        move_pruning_automaton();
+        chrono::duration<double, milli> build_ms = chrono::steady_clock::now() - build_start;
+        automaton_ms = build_ms.count();
+    }
+
+    auto batch_start = chrono::steady_clock::now();
+    auto since_start_ms = [&batch_start]() {
+        chrono::duration<double, milli> d = chrono::steady_clock::now() - batch_start;
+        return d.count();
+    };
+    atomic<size_t> next_job(0);
+    vector<thread> pool;
+    for (int t = 0; t < workers; t++) {
+        pool.emplace_back([&]() {
+            if (lanes > 1) {
+                lane_ida_star_batch(jobs, order, next_job, options, lanes, batch_start);
+                return;
+            }
+            SearchContext context;
+            for (size_t n = next_job++; n < order.size(); n = next_job++) {
+                BatchJob &job = jobs[order[n]];
+                job.wait_ms = since_start_ms();
+                if (job.solvable) {
+                    job.result = context.solve(job.puzzle, heuristic_type, options);
+                }
+                job.run_ms = since_start_ms() - job.wait_ms;
+            }
+        });
+    }
+    for (thread &worker : pool) {
+        worker.join();
+    }
+    double makespan_ms = since_start_ms();
+
+    // One line per job in input order: index, estimated cost, depth (or status), nodes expanded and reopened, memory,
+    // wait and run time.
+    double total_wait_ms = 0, total_run_ms = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        BatchJob &job = jobs[i];
+        string status = !job.solvable ? "unsolvable"
+                      : job.result.solved ? to_string(job.result.depth)
+                      : "stopped(" + job.result.stop_reason + ")";
+        cout << i << " cost=" << job.estimated_cost << " depth=" << status << " nodes=" << job.result.nodes_expanded
+             << " reopened=" << job.result.nodes_reopened << " mem_kb="
+             << (job.result.memory.frontier_bytes + job.result.memory.closed_bytes + job.result.memory.arena_bytes) / 1024
+             << " wait_ms=" << job.wait_ms << " run_ms=" << job.run_ms << '\n';
+        total_wait_ms += job.wait_ms;
+        total_run_ms += job.run_ms;
+    }
+    cout << '\n' << "Jobs: " << jobs.size() << " (" << (fifo ? "FIFO" : "longest expected first") << ", "
+         << workers << " workers";
+    if (lanes > 1) {
+        cout << ", " << lanes << " lanes each";
+    }
+    cout << ")" << '\n';
+    if (cost_model) {
+        cout << "Cost model: CDP from " << cost_model->samples << " samples in " << cost_model_ms << " milliseconds" << '\n';
+    }
+    if (automaton_ms > 0) {
+        cout << "Move-pruning automaton: built in " << automaton_ms << " milliseconds, before the makespan starts" << '\n';
+    }
+    cout << "Total run time: " << total_run_ms << " milliseconds" << '\n'
+         << "Mean queue wait: " << (jobs.empty() ? 0 : total_wait_ms / jobs.size()) << " milliseconds" << '\n'
+         << "Makespan: " << makespan_ms << " milliseconds" << '\n' << '\n';
+    stop_expansion_trace();
+    return 0;
+}
+
+
+// Change in f = g + h when the blank at `blank` moves in direction m, for every tile that could be moved.
+// Indexed by ((tile * PUZZLE_TILES) + blank) * 4 + m; moves off the board hold INT32_MAX. Both heuristics
+// are sums of per-tile costs, so the change only depends on the moved tile and where it goes.
+vector<int> build_delta_f_table(string _heuristic_type) {
+    vector<vector<int>> tile_cost(PUZZLE_TILES, vector<int>(PUZZLE_TILES, 0));    // Heuristic share of a tile at a position.
+    for (int tile = 1; tile < PUZZLE_TILES; tile++) {
+        int goal = find(goal_tiles().begin(), goal_tiles().end(), tile) - goal_tiles().begin();
+        for (int pos = 0; pos < PUZZLE_TILES; pos++) {
+            if (_heuristic_type.find("Manhattan") != string::npos) {
+                tile_cost[tile][pos] = BOARD.manhattan[tile][pos];
+            } else if (_heuristic_type.find("Misplaced") != string::npos) {
+                tile_cost[tile][pos] = (pos != goal);
+            }
+        }
+    }
+
+    vector<int> delta_f(PUZZLE_TILES * PUZZLE_TILES * 4, INT32_MAX);
+    for (int tile = 1; tile < PUZZLE_TILES; tile++) {
+        for (int blank = 0; blank < PUZZLE_TILES; blank++) {
+            for (int m = 0; m < 4; m++) {
+                int next = BOARD.neighbour[blank][m];
+                if (next >= 0) {
+                    // The tile slides from the blank's new position into the blank's old one.
+                    delta_f[(tile * PUZZLE_TILES + blank) * 4 + m] = 1 + tile_cost[tile][blank] - tile_cost[tile][next];
+                }
+            }
+        }
+    }
+    return delta_f;
+}
+
+// Enhanced Partial Expansion A* (EPEA*): a popped node only generates the children whose f equals its
+// stored f, using the delta f table instead of building every child. If some children have a larger f,
+// the node goes back into the queue with the smallest of those as its new stored f. Surplus children
+// therefore never enter the queue, which keeps it much smaller than in general_search.
+SearchResult partial_expansion_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    static const vector<int> manhattan_delta_f = build_delta_f_table("Manhattan");
+    static const vector<int> misplaced_delta_f = build_delta_f_table("Misplaced");
+    const vector<int> &delta_f = (heuristic_type.find("Manhattan") != string::npos) ? manhattan_delta_f : misplaced_delta_f;
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+
+    PuzzleQueue &q = context.queue;
+    q.push(PuzzleNode(problem, x_blank, y_blank, 0, compute_heuristic(problem, heuristic_type), nullptr));
+
+    // Cheapest g found so far for each puzzle; nodes reached more expensively are dropped.
+    StampedMap<vector<vector<int>>, int> &best_g = context.puzzle_g;
+    best_g[problem] = 0;
+
+    int nodes_expanded = 0, q_max_size = 1;
+    PuzzleNodeArena &parents = context.parents;     // Expanded nodes copied as their children's parent.
+    while (!q.empty()) {
+        q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
+
+        if (limits.should_stop(nodes_expanded)) {
+            result.lower_bound = (int)q.top().f;    // Stored f values never overestimate.
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = puzzle_search_memory(q_max_size, context);
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+
+        PuzzleNode curr = q.top();
+        q.pop();
+        if (curr.g > best_g[curr.puzzle]) {     // Skip nodes that were reached more cheaply since.
+            continue;
+        }
+        nodes_expanded++;
+
+        if (curr.puzzle == PUZZLE_GOAL) {   // Successful search.
+            if (options.verbose) {
+                print_puzzle_path(&curr);
+                print_summary(curr.g, nodes_expanded, q_max_size);
+            }
+            result.solved = true;
+            result.depth = curr.g;
+            result.lower_bound = curr.g;
+            result.moves = trace_moves(&curr);
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = puzzle_search_memory(q_max_size, context);
+            return result;
+        }
+
+        int blank = curr.x_blank * PUZZLE_COLS + curr.y_blank;
+        double next_f = INT32_MAX;      // Smallest child f above the stored f.
+        PuzzleNode* parent = nullptr;
+        for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+            int new_blank = BOARD.neighbour[blank][m];
+            if (new_blank < 0) {
+                continue;   // Ignore tiles that are out-of-bounds.
+            }
+            int new_x_blank = new_blank / PUZZLE_COLS, new_y_blank = new_blank % PUZZLE_COLS;
+
+            int tile = curr.puzzle[new_x_blank][new_y_blank];
+            double child_f = curr.g + curr.h + delta_f[(tile * PUZZLE_TILES + blank) * 4 + m];
+            if (child_f > curr.f) {
+                next_f = min(next_f, child_f);  // Deferred until the parent is popped again at this f.
+                continue;
+            }
+            if (child_f < curr.f) {
+                continue;   // Already generated when the parent was expanded at a smaller stored f.
+            }
+
+            vector<vector<int>> new_puzzle = curr.puzzle;
+            swap(new_puzzle[curr.x_blank][curr.y_blank], new_puzzle[new_x_blank][new_y_blank]);
+            int* known = best_g.find(new_puzzle);
+            if (known != nullptr && *known <= curr.g+1) {
+                continue;   // Already reached at least as cheaply.
+            }
+            best_g[new_puzzle] = curr.g+1;
+
+            if (parent == nullptr) {
+                parent = parents.add(curr);
+            }
+            q.push(PuzzleNode(new_puzzle, new_x_blank, new_y_blank, curr.g+1, (int)(child_f - curr.g - 1), parent));
+        }
+
+        if (next_f < INT32_MAX) {   // Re-inserts the parent to generate its remaining children later.
+            curr.f = next_f;
+            q.push(curr);
+        }
+    }
+    if (options.verbose) {
+        print_failure();    // Unsuccessful search.
+    }
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = q_max_size;
+    result.memory = puzzle_search_memory(q_max_size, context);
+    return result;
+}
+
+
+// Packs a puzzle into 4 bits per tile in row-major order (tile i in bits 4i..4i+3); fits boards of up to 16 tiles.
+uint64_t pack_puzzle(const vector<vector<int>> &_p) {
+    uint64_t packed = 0;
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        packed |= (uint64_t)_p[i / PUZZLE_COLS][i % PUZZLE_COLS] << (4 * i);
+    }
+    return packed;
+}
+
+// Whether this board fits pack_puzzle(); if not, says so for the searches that need packed boards.
+bool packed_boards_fit() {
+    if (PUZZLE_TILES > 16) {
+        cout << "Packed boards only fit puzzles of up to 16 tiles." << '\n' << '\n';
+        return false;
+    }
+    return true;
+}
+
+vector<vector<int>> unpack_puzzle(uint64_t _packed) {
+    vector<vector<int>> p(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        p[i / PUZZLE_COLS][i % PUZZLE_COLS] = (_packed >> (4 * i)) & 0xf;
+    }
+    return p;
+}
+
+// Turns a root-to-goal sequence of packed boards into linked puzzle nodes, so the path can be printed and
+// traced like the other modes. Returns the goal node.
+PuzzleNode* rebuild_path(const vector<uint64_t> &_boards, string &_heuristic_type) {
+    PuzzleNode* curr = nullptr;
+    for (size_t i = 0; i < _boards.size(); i++) {
+        vector<vector<int>> puzzle = unpack_puzzle(_boards[i]);
+        int x_blank, y_blank;
+        locate_blank(puzzle, x_blank, y_blank);
+        curr = new PuzzleNode(puzzle, x_blank, y_blank, i, compute_heuristic(puzzle, _heuristic_type), curr);
+    }
+    return curr;
+}
+
+// Frees a path made by rebuild_path(), once its moves have been traced.
+void delete_path(PuzzleNode* _node) {
+    while (_node != nullptr) {
+        PuzzleNode* parent = _node->parent;
+        delete _node;
+        _node = parent;
+    }
+}
+
+// Queue key: f in the top 8 bits, then 255 - g (so deeper nodes win ties on f), then the node index in the
+// low 48 bits, of which CompactNodeStore::MAX_NODES keeps it to 32. Comparing keys as plain integers
+// orders them exactly like the node priorities.
+uint64_t make_compact_key(int _f, int _g, uint64_t _index) {
+    return ((uint64_t)_f << 56) | ((uint64_t)(255 - _g) << 48) | _index;
+}
+
+// Memory of the compact modes' reusable structures, which keep their capacity from earlier solves.
+MemoryUsage compact_search_memory(SearchContext &_context) {
+    MemoryUsage memory;
+    memory.frontier_bytes = _context.frontier.capacity() * sizeof(uint64_t);
+    memory.closed_bytes = _context.closed.memory_bytes();
+    memory.closed_load_factor = _context.closed.load_factor();
+    memory.arena_bytes = _context.nodes.memory_bytes();
+    memory.stored_nodes = _context.nodes.boards.size();
+    return memory;
+}
+
+// A* on packed boards with 8-byte queue entries and a structure-of-arrays node store. Children are built
+// by swapping two nibbles, and their f comes from the delta f table. Like general_search, it skips
+// already visited puzzles when they are popped.
+SearchResult compact_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    static const vector<int> manhattan_delta_f = build_delta_f_table("Manhattan");
+    static const vector<int> misplaced_delta_f = build_delta_f_table("Misplaced");
+    const vector<int> &delta_f = (heuristic_type.find("Manhattan") != string::npos) ? manhattan_delta_f : misplaced_delta_f;
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    const uint64_t goal = pack_puzzle(PUZZLE_GOAL);
+
+    CompactNodeStore &nodes = context.nodes;
+    vector<uint64_t> &q = context.frontier;     // Min-heap maintained with push_heap/pop_heap.
+    StampedClosedSet &puzzle_visits = context.closed;
+    nodes.add(pack_puzzle(problem), 0, x_blank * PUZZLE_COLS + y_blank, 0);
+    q.push_back(make_compact_key(compute_heuristic(problem, heuristic_type), 0, 0));
+
+    int nodes_expanded = 0, q_max_size = 1;
+    while (!q.empty()) {
+        q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
+
+        if (nodes.full()) {
+            limits.stop_reason = "node store full";
+        }
+        if (!limits.stop_reason.empty() || limits.should_stop(nodes_expanded)) {
+            result.lower_bound = q.front() >> 56;   // f of the best queued node.
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = compact_search_memory(context);
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+
+        pop_heap(q.begin(), q.end(), greater<uint64_t>());
+        uint64_t key = q.back();
+        q.pop_back();
+        uint32_t index = (uint32_t)(key & 0xffffffffffffULL);
+        int f = key >> 56, g = nodes.gs[index], blank = nodes.blanks[index];
+        uint64_t board = nodes.boards[index];
+        if (!puzzle_visits.insert(board)) {     // Skip already visited nodes.
+            continue;
+        }
+        nodes_expanded++;
+        result.layers.record(g, f);
+        if (expansion_tracer != nullptr) {
+            expansion_tracer->record(board, blank, g, f - g, f, q.size());
+        }
+
+        if (board == goal) {    // Successful search.
+            vector<uint64_t> path = {board};
+            for (uint32_t i = index; nodes.parents[i] != i; i = nodes.parents[i]) {
+                path.push_back(nodes.boards[nodes.parents[i]]);
+            }
+            reverse(path.begin(), path.end());
+            PuzzleNode* curr = rebuild_path(path, heuristic_type);
+            if (options.verbose) {
+                print_puzzle_path(curr);
+                print_summary(g, nodes_expanded, q_max_size);
+            }
+            result.solved = true;
+            result.depth = g;
+            result.lower_bound = g;
+            result.moves = trace_moves(curr);
+            delete_path(curr);
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = compact_search_memory(context);
+            return result;
+        }
+
+        for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+            int new_blank = BOARD.neighbour[blank][m];
+            if (new_blank < 0) {
+                continue;   // Ignore tiles that are out-of-bounds.
+            }
+            uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+            uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));  // Slides the tile into the blank.
+            int new_f = f + delta_f[(tile * PUZZLE_TILES + blank) * 4 + m];
+            q.push_back(make_compact_key(new_f, g+1, nodes.add(new_board, index, new_blank, g+1)));
+            push_heap(q.begin(), q.end(), greater<uint64_t>());
+        }
+    }
+    if (options.verbose) {
+        print_failure();    // Unsuccessful search.
+    }
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = q_max_size;
+    result.memory = compact_search_memory(context);
+    return result;
+}
+
+
+// Memory of fringe search's cache, which holds every visited puzzle and links the fringe through it, and of
+// its index. Both keep their capacity from earlier solves.
+MemoryUsage fringe_search_memory(SearchContext &_context) {
+    MemoryUsage memory;
+    memory.closed_bytes = _context.fringe_index.memory_bytes();
+    memory.closed_load_factor = _context.fringe_index.load_factor();
+    memory.arena_bytes = _context.fringe.capacity() * sizeof(FringeEntry);
+    memory.stored_nodes = _context.fringe.size();
+    return memory;
+}
+
+// Fringe Search: iterates f thresholds like IDA*, but keeps the frontier in a doubly linked list and
+// caches every visited puzzle with its best g, so no path is expanded twice and no heap is needed. Each
+// pass walks the list from the front; nodes above the threshold stay for the next pass, and expanded
+// nodes are replaced in place by their children, which are visited later in the same pass.
+SearchResult fringe_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    static const vector<int> manhattan_delta_f = build_delta_f_table("Manhattan");
+    static const vector<int> misplaced_delta_f = build_delta_f_table("Misplaced");
+    const vector<int> &delta_f = (heuristic_type.find("Manhattan") != string::npos) ? manhattan_delta_f : misplaced_delta_f;
+
+    // One cache entry per visited puzzle; prev/next link the entries that are currently in the fringe.
+    const int32_t NONE = -1;
+    vector<FringeEntry> &cache = context.fringe;
+    StampedMap<uint64_t, int32_t> &cache_index = context.fringe_index;
+    int32_t head = NONE;
+    int fringe_size = 0;
+
+    auto unlink = [&](int32_t _e) {
+        FringeEntry &entry = cache[_e];
+        if (entry.prev != NONE) {
+            cache[entry.prev].next = entry.next;
+        } else {
+            head = entry.next;
+        }
+        if (entry.next != NONE) {
+            cache[entry.next].prev = entry.prev;
+        }
+        entry.in_fringe = false;
+        fringe_size--;
+    };
+    auto link_after = [&](int32_t _e, int32_t _after) {     // Links _e right after _after (or at the head).
+        FringeEntry &entry = cache[_e];
+        entry.prev = _after;
+        entry.next = (_after == NONE) ? head : cache[_after].next;
+        if (entry.next != NONE) {
+            cache[entry.next].prev = _e;
+        }
+        if (_after == NONE) {
+            head = _e;
+        } else {
+            cache[_after].next = _e;
+        }
+        entry.in_fringe = true;
+        fringe_size++;
+    };
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    const uint64_t goal = pack_puzzle(PUZZLE_GOAL);
+    int root_h = compute_heuristic(problem, heuristic_type);
+    cache.push_back({pack_puzzle(problem), 0, root_h, x_blank * PUZZLE_COLS + y_blank, NONE, NONE, NONE, false});
+    cache_index[cache[0].board] = 0;
+    link_after(0, NONE);
+
+    int f_limit = root_h, nodes_expanded = 0, fringe_max_size = 1;
+    int32_t found = NONE;
+    while (found == NONE && head != NONE) {
+        int f_min = INT32_MAX;      // Smallest f above the threshold; the next pass's threshold.
+        int32_t e = head;
+        while (e != NONE) {
+            if (limits.should_stop(nodes_expanded)) {
+                result.lower_bound = f_limit;   // Everything below the threshold was searched without a solution.
+                result.stop_reason = limits.stop_reason;
+                result.nodes_expanded = nodes_expanded;
+                result.q_max_size = fringe_max_size;
+                result.memory = fringe_search_memory(context);
+                if (options.verbose) {
+                    print_stopped(result);
+                }
+                return result;
+            }
+
+            FringeEntry curr = cache[e];
+            if (curr.g + curr.h > f_limit) {
+                f_min = min(f_min, curr.g + curr.h);
+                e = curr.next;
+                continue;   // Stays in the fringe for a later pass.
+            }
+            if (curr.board == goal) {
+                found = e;
+                break;
+            }
+            nodes_expanded++;
+
+            // Children go right after the node in reverse order, so they are visited next in move order.
+            for (int m = 3; m >= 0; m--) {
+                int new_blank = BOARD.neighbour[curr.blank][m];
+                if (new_blank < 0) {
+                    continue;   // Ignore tiles that are out-of-bounds.
+                }
+                uint64_t tile = (curr.board >> (4 * new_blank)) & 0xf;
+                uint64_t new_board = curr.board ^ (tile << (4 * new_blank)) ^ (tile << (4 * curr.blank));
+                int new_h = curr.h + delta_f[(tile * PUZZLE_TILES + curr.blank) * 4 + m] - 1;
+
+                int32_t* known = cache_index.find(new_board);
+                int32_t child;
+                if (known != nullptr) {
+                    child = *known;
+                    if (cache[child].g <= curr.g+1) {
+                        continue;   // Already reached at least as cheaply.
+                    }
+                    if (cache[child].in_fringe) {
+                        unlink(child);
+                    }
+                    cache[child].g = curr.g+1;
+                    cache[child].parent = e;
+                } else {
+                    child = cache.size();
+                    cache.push_back({new_board, curr.g+1, new_h, new_blank, e, NONE, NONE, false});
+                    cache_index[new_board] = child;
+                }
+                link_after(child, e);
+            }
+            fringe_max_size = max(fringe_max_size, fringe_size);
+
+            int32_t next = cache[e].next;
+            unlink(e);
+            e = next;
+        }
+        f_limit = f_min;
+    }
+    result.memory = fringe_search_memory(context);
+
+    if (found == NONE) {
+        if (options.verbose) {
+            print_failure();    // Unsuccessful search.
+        }
+        result.nodes_expanded = nodes_expanded;
+        result.q_max_size = fringe_max_size;
+        return result;
+    }
+
+    vector<uint64_t> path;
+    for (int32_t e = found; e != NONE; e = cache[e].parent) {
+        path.push_back(cache[e].board);
+    }
+    reverse(path.begin(), path.end());
+    PuzzleNode* goal_node = rebuild_path(path, heuristic_type);
+    if (options.verbose) {
+        print_puzzle_path(goal_node);
+        print_summary(goal_node->g, nodes_expanded, fringe_max_size);
+    }
+    result.solved = true;
+    result.depth = goal_node->g;
+    result.lower_bound = goal_node->g;
+    result.moves = trace_moves(goal_node);
+    delete_path(goal_node);
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = fringe_max_size;
+    return result;
+}
+
+
+// Handles "--benchmark [ALGORITHM...]" plus the usual search flags: runs each algorithm (A* Manhattan and
+// Fringe Search by default) on the ten premade puzzles and prints one row per puzzle and algorithm.
+int run_benchmark(int argc, char* argv[]) {
+    SearchOptions options;
+    if (!parse_search_flags(argc, argv, options)) {
+        return 1;
+    }
+    options.verbose = false;
+    options.checkpoint_path.clear();
+    options.resume_path.clear();
+
+    vector<int> algorithms;
+    for (int i = 2; i < argc && argv[i][0] != '-'; i++) {
+        algorithms.push_back(atoi(argv[i]));
+    }
+    if (algorithms.empty()) {
+        algorithms = {3, 8};
+    }
+
+    SearchContext context;
+    cout << "difficulty  algorithm                   depth  nodes_expanded  max_queue_size  milliseconds" << '\n';
+    for (int difficulty = 0; difficulty <= 9; difficulty++) {
+        for (int algorithm_type : algorithms) {
+            string heuristic_type = heuristic_type_for_algorithm(algorithm_type);
+            if (heuristic_type.empty()) {
+                cerr << "Unknown algorithm " << algorithm_type << "." << '\n';
+                return 1;
+            }
+            auto start = chrono::steady_clock::now();
+            SearchResult result = context.solve(init_premade_initial_puzzle(difficulty), heuristic_type, options);
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+            cout << setw(10) << difficulty << "  " << left << setw(26) << heuristic_type << right
+                 << "  " << setw(5) << result.depth << "  " << setw(14) << result.nodes_expanded
+                 << "  " << setw(14) << result.q_max_size << "  " << setw(12) << fixed << setprecision(3)
+                 << elapsed.count() << defaultfloat << '\n';
+        }
+    }
+
+    vector<string> pdb_types;
+    for (int algorithm_type : algorithms) {
+        if (heuristic_type_for_algorithm(algorithm_type).find("PDB") != string::npos) {
+            pdb_types.push_back(heuristic_type_for_algorithm(algorithm_type));
+        }
+    }
+    if (!pdb_types.empty()) {
+        print_pattern_database_benchmark(pdb_types, options, context);
+    }
+    return 0;
+}
+
+
+// Handles "--verify [ALGORITHM...] [--samples N | --all] [--threads T] [--seed S] [--length L]" plus the usual
+// search flags. On 3x3 boards every algorithm's depth is checked against the exact breadth-first distance
+// table, for N uniformly sampled states or for every solvable state with --all. On larger boards the
+// instances are random walks of L moves, and the algorithms are checked against each other. Every returned
+// move sequence is replayed. Optimal modes must match the reference depth, weighted A* and ARA* must stay
+// within w of it, and beam search and LRTA* must not beat it. On any failure the shallowest failing board is
+// printed and the exit status is 1.
+int run_verification(int argc, char* argv[]) {
+    SearchOptions options;
+    if (!parse_search_flags(argc, argv, options)) {
+        return 1;
+    }
+    options.verbose = false;
+    options.checkpoint_path.clear();
+    options.resume_path.clear();
+    options.goal.clear();
+    options.cancel_token = &interrupt_requested;
+    signal(SIGINT, [](int) { interrupt_requested.store(true); });
+
+    const bool exact = PUZZLE_TILES <= 12;  // Whether exact_depth() can serve as the oracle.
+    vector<int> algorithms;
+    for (int i = 2; i < argc && argv[i][0] != '-'; i++) {
+        algorithms.push_back(atoi(argv[i]));
+    }
+    if (algorithms.empty()) {
+        algorithms = exact ? vector<int>{7, 8, 9, 10, 13, 14, 15} : vector<int>{7, 8, 9, 10};
+    }
+    GeneratorOptions generator;
+    generator.mode = exact ? "uniform" : "walk";
+    generator.walk_length = 40;
+    bool all = false;
+    for (int i = 2; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--all") {
+            all = PUZZLE_TILES <= 9;    // Every state, in the distance table's BFS order.
+        } else if (i+1 < argc && flag == "--samples") {
+            generator.count = max(1LL, atoll(argv[++i]));
+        } else if (i+1 < argc && flag == "--threads") {
+            generator.threads = max(1, atoi(argv[++i]));
+        } else if (i+1 < argc && flag == "--seed") {
+            generator.seed = strtoull(argv[++i], nullptr, 10);
+        } else if (i+1 < argc && flag == "--length") {
+            generator.walk_length = max(0, atoi(argv[++i]));
+        }
+    }
+    vector<string> heuristic_types;
+    for (int algorithm_type : algorithms) {
+        heuristic_types.push_back(heuristic_type_for_algorithm(algorithm_type));
+        if (heuristic_types.back().empty()) {
+            cerr << "Unknown algorithm " << algorithm_type << "." << '\n';
+            return 1;
+        }
+    }
+
+    // The instances, with their exact depths on boards of up to 12 tiles and -1 elsewhere.
+    vector<int8_t> depths;
+    vector<uint8_t> tiles;
+    if (all) {
+        distance_table();
+        generator.count = distance_table_bfs_order.size();
+        depths.resize(generator.count);
+        tiles.resize(generator.count * PUZZLE_TILES);
+        for (long long n = 0; n < generator.count; n++) {
+            unrank_tiles(distance_table_bfs_order[n], &tiles[n * PUZZLE_TILES]);
+            depths[n] = distance_table()[distance_table_bfs_order[n]];
+        }
+    } else {
+        if (exact) {
+            exact_depth(goal_tiles().data());   // Builds the table once up front; generate_block only reads it.
+        }
+        depths.resize(generator.count);
+        tiles.resize(generator.count * PUZZLE_TILES);
+        for (long long b = 0; b * 4096 < generator.count; b++) {
+            generate_block(generator, b, b * 4096, min(generator.count, (b+1) * 4096), depths, tiles);
+        }
+    }
+
+    // Replays the moves from the instance; true if each is legal and they end on the goal.
+    auto replay = [](const uint8_t* _tiles, const string &_moves) {
+        const string directions = "UDLR";
+        vector<uint8_t> board(_tiles, _tiles + PUZZLE_TILES);
+        int blank = find(board.begin(), board.end(), 0) - board.begin();
+        for (char move : _moves) {
+            size_t m = directions.find(move);
+            int cell = m < 4 ? BOARD.neighbour[blank][m] : -1;
+            if (cell < 0) {
+                return false;
+            }
+            swap(board[blank], board[cell]);
+            blank = cell;
+        }
+        return board == goal_tiles();
+    };
+
+    struct Failure {
+        long long instance;
+        int reference;      // Exact depth, or the first optimal algorithm's depth on larger boards.
+        string algorithm, reason;
+    };
+    vector<Failure> failures;
+    vector<long long> checked(algorithms.size(), 0), unsolved(algorithms.size(), 0);
+    vector<double> run_ms(algorithms.size(), 0);
+    mutex results_lock;
+    atomic<long long> next_instance(0);
+    auto start = chrono::steady_clock::now();
+
+    vector<thread> workers;
+    for (int t = 0; t < generator.threads; t++) {
+        workers.emplace_back([&]() {
+            SearchContext context;
+            vector<long long> local_checked(algorithms.size(), 0), local_unsolved(algorithms.size(), 0);
+            vector<double> local_ms(algorithms.size(), 0);
+            vector<Failure> local_failures;
+            for (long long n = next_instance++; n < generator.count && !interrupt_requested.load(); n = next_instance++) {
+                const uint8_t* instance = &tiles[n * PUZZLE_TILES];
+                vector<vector<int>> puzzle(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+                for (int i = 0; i < PUZZLE_TILES; i++) {
+                    puzzle[i / PUZZLE_COLS][i % PUZZLE_COLS] = instance[i];
+                }
+                int reference = depths[n];
+                for (size_t a = 0; a < algorithms.size(); a++) {
+                    const string &type = heuristic_types[a];
+                    bool bounded = type.find("Weighted") != string::npos || type.find("Anytime") != string::npos;
+                    bool incomplete = type.find("Beam") != string::npos || type.find("LRTA*") != string::npos;
+                    auto solve_start = chrono::steady_clock::now();
+                    SearchResult result = context.solve(puzzle, type, options);
+                    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - solve_start;
+                    local_ms[a] += elapsed.count();
+                    local_checked[a]++;
+
+                    string reason;
+                    if (!result.solved) {
+                        if (!result.stop_reason.empty() || incomplete) {
+                            local_unsolved[a]++;    // Stopped by a limit, or a mode that may give up.
+                            continue;
+                        }
+                        reason = "no solution found";
+                    } else if (!replay(instance, result.moves)) {
+                        reason = "moves \"" + result.moves + "\" do not reach the goal";
+                    } else if ((int)result.moves.size() != result.depth) {
+                        reason = "depth " + to_string(result.depth) + " but " + to_string(result.moves.size()) + " moves";
+                    } else if (reference < 0 && !bounded && !incomplete) {
+                        reference = result.depth;   // The first optimal mode sets the reference on larger boards.
+                    } else if (reference >= 0 && result.depth < reference) {
+                        reason = "depth " + to_string(result.depth) + " beats the optimum";
+                    } else if (reference >= 0 && !bounded && !incomplete && result.depth != reference) {
+                        reason = "depth " + to_string(result.depth) + " is not optimal";
+                    } else if (reference >= 0 && bounded && result.depth > options.weight * reference) {
+                        reason = "depth " + to_string(result.depth) + " exceeds the bound " + to_string(options.weight) + " * optimum";
+                    }
+                    if (!reason.empty()) {
+                        local_failures.push_back({n, reference, heuristic_types[a], reason});
+                    }
+                }
+            }
+            lock_guard<mutex> guard(results_lock);
+            for (size_t a = 0; a < algorithms.size(); a++) {
+                checked[a] += local_checked[a];
+                unsolved[a] += local_unsolved[a];
+                run_ms[a] += local_ms[a];
+            }
+            failures.insert(failures.end(), local_failures.begin(), local_failures.end());
+        });
+    }
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+
+    cout << "Verified " << (all ? "every solvable state" : to_string(generator.count) + " instances") << " against "
+         << (exact ? "the exact distance table" : "the first optimal algorithm") << " with " << generator.threads
+         << " threads in " << fixed << setprecision(1) << elapsed.count() << " ms" << '\n' << '\n'
+         << "algorithm                   checked  unsolved  failures  mean_ms" << '\n';
+    for (size_t a = 0; a < algorithms.size(); a++) {
+        long long failed = count_if(failures.begin(), failures.end(), [&](const Failure &_f) { return _f.algorithm == heuristic_types[a]; });
+        cout << left << setw(26) << heuristic_types[a] << right << "  " << setw(7) << checked[a] << "  " << setw(8) << unsolved[a]
+             << "  " << setw(8) << failed << "  " << setw(7) << setprecision(3) << (checked[a] ? run_ms[a] / checked[a] : 0.0) << '\n';
+    }
+    cout << defaultfloat << '\n';
+    if (interrupt_requested.load()) {
+        cout << "Interrupted before every instance was checked." << '\n';
+    }
+    if (failures.empty()) {
+        cout << "All checks passed." << '\n';
+        return interrupt_requested.load() ? 1 : 0;
+    }
+
+    // The shallowest failing board is the easiest to debug.
+    const Failure &minimal = *min_element(failures.begin(), failures.end(), [](const Failure &_a, const Failure &_b) {
+        return make_pair(_a.reference, _a.instance) < make_pair(_b.reference, _b.instance);
+    });
+    cout << failures.size() << " check(s) failed. Shallowest failing board (reference depth " << minimal.reference << "):" << '\n';
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        cout << (int)tiles[minimal.instance * PUZZLE_TILES + i] << ((i+1) % PUZZLE_COLS == 0 ? '\n' : ' ');
+    }
+    cout << minimal.algorithm << ": " << minimal.reason << '\n';
+    return 1;
+}
+
+// Handles "--predict ALGORITHM [FILE] [--samples N] [--seed S] [--threshold D] [--check]" plus the usual
+// search flags. Samples a CDP model for the algorithm's heuristic, then predicts how many nodes IDA* with
+// that heuristic expands on each board of FILE (the premade puzzles without one). The last iteration's
+// threshold is the depth given in FILE, else --threshold D, else a guess from the Manhattan distance. With
+// --check each board is also solved by IDA* without the transposition table and move pruning, which is the
+// tree the model describes, and the iterations it completed are compared with their prediction.
+int run_prediction(int argc, char* argv[]) {
+    SearchOptions options;
+    if (!parse_search_flags(argc, argv, options)) {
+        return 1;
+    }
+    options.verbose = false;
+    options.checkpoint_path.clear();
+    options.resume_path.clear();
+    options.goal.clear();
+    options.transposition_entries = 0;
+    options.move_pruning = false;
+
+    string heuristic_type = heuristic_type_for_algorithm(atoi(argv[2]));
+    if (heuristic_type.empty()) {
+        cerr << "Unknown algorithm " << argv[2] << "." << '\n';
+        return 1;
+    }
+    long long samples = 1000000;
+    unsigned seed = 1;
+    int fixed_threshold = -1;
+    bool check = false;
+    string path;
+    for (int i = 3; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--check") {
+            check = true;
+        } else if (i+1 < argc && flag == "--samples") {
+            samples = max(1LL, atoll(argv[++i]));
+        } else if (i+1 < argc && flag == "--seed") {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (i+1 < argc && flag == "--threshold") {
+            fixed_threshold = max(0, atoi(argv[++i]));
+        } else if (i == 3 && flag[0] != '-') {
+            path = flag;
+        }
+    }
+
+    vector<vector<vector<int>>> boards;
+    vector<int> depths;     // Optimal depth from FILE, or -1.
+    if (path.empty()) {
+        for (int d = 0; d <= 9; d++) {
+            boards.push_back(init_premade_initial_puzzle(d));
+            depths.push_back(-1);
+        }
+    } else {
+        ifstream in(path);
+        if (!in) {
+            cerr << "Unable to open \"" << path << "\"." << '\n';
+            return 1;
+        }
+        string line;
+        while (getline(in, line)) {
+            istringstream numbers(line);
+            vector<int> values;
+            int value;
+            while (numbers >> value) {
+                values.push_back(value);
+            }
+            if ((int)values.size() != PUZZLE_TILES && (int)values.size() != PUZZLE_TILES+1) {
+                continue;   // Blank or malformed line.
+            }
+            int offset = values.size() - PUZZLE_TILES;
+            vector<vector<int>> puzzle(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+            for (int i = 0; i < PUZZLE_TILES; i++) {
+                puzzle[i / PUZZLE_COLS][i % PUZZLE_COLS] = values[offset + i];
+            }
+            boards.push_back(puzzle);
+            depths.push_back(offset > 0 ? values[0] : -1);
+        }
+    }
+
+    auto sample_start = chrono::steady_clock::now();
+    CdpModel model = sample_cdp_model(heuristic_type, samples, seed);
+    chrono::duration<double, milli> sample_ms = chrono::steady_clock::now() - sample_start;
+    size_t types_seen = 0;
+    for (auto &children : model.children) {
+        types_seen += !children.empty();
+    }
+
+    double total_predict_us = 0, completed_predicted = 0, completed_actual = 0;
+    vector<double> ratios;
+    int predictions = 0;
+    SearchContext context;  // Reused by the checking searches.
+    for (size_t n = 0; n < boards.size(); n++) {
+        vector<vector<int>> &puzzle = boards[n];
+        uint8_t tiles[PUZZLE_TILES];
+        for (int i = 0; i < PUZZLE_TILES; i++) {
+            tiles[i] = puzzle[i / PUZZLE_COLS][i % PUZZLE_COLS];
+        }
+        if (!is_solvable_tiles(tiles)) {
+            cout << n << " unsolvable" << '\n';
+            continue;
+        }
+        int threshold = (depths[n] >= 0) ? depths[n] : (fixed_threshold >= 0) ? fixed_threshold : estimate_solution_depth(puzzle);
+        auto predict_start = chrono::steady_clock::now();
+        double predicted = predict_ida_star_expansions(model, puzzle, threshold);
+        chrono::duration<double, micro> predict_us = chrono::steady_clock::now() - predict_start;
+        total_predict_us += predict_us.count();
+        predictions++;
+        cout << n << " h=" << compute_heuristic(puzzle, heuristic_type) << " threshold=" << threshold
+             << " predicted=" << predicted << " predict_us=" << predict_us.count();
+
+        if (check) {
+            context.reset();
+            SearchResult result = ida_star_search(puzzle, heuristic_type, options, context);
+            if (!result.solved) {
+                cout << " stopped(" << result.stop_reason << ")" << '\n';
+                continue;
+            }
+            // Only iterations below the solution depth ran to completion.
+            double actual = 0;
+            for (int f = 0; f < result.depth && f < (int)result.layers.by_f.size(); f++) {
+                actual += result.layers.by_f[f];
+            }
+            double expected = predict_ida_star_expansions(model, puzzle, result.depth - 1);
+            cout << " depth=" << result.depth << " completed_actual=" << actual << " completed_predicted=" << expected;
+            if (actual > 0) {
+                cout << " ratio=" << expected / actual;
+                ratios.push_back(expected / actual);
+                completed_predicted += expected;
+                completed_actual += actual;
+            }
+        }
+        cout << '\n';
+    }
+
+    cout << '\n' << "Model: " << heuristic_type << ", " << model.samples << " samples, " << types_seen << " types, sampled in "
+         << sample_ms.count() << " milliseconds" << '\n'
+         << "Mean prediction time: " << (predictions > 0 ? total_predict_us / predictions : 0) << " microseconds" << '\n';
+    if (!ratios.empty()) {
+        sort(ratios.begin(), ratios.end());
+        cout << "Predicted / actual expansions of completed iterations: " << completed_predicted / completed_actual
+             << " in total, " << ratios[ratios.size() / 2] << " median" << '\n';
+    }
+    cout << '\n';
+    return 0;
+}
+
+
+// Finite-state automaton that rejects redundant move sequences in depth-first search. Moves are numbered
+// like BOARD.neighbour (0 = U, 1 = D, 2 = L, 3 = R). It is built once by enumerating every sequence of up to
+// MAX_LENGTH moves on an unbounded board: a sequence is redundant if a shorter or alphabetically earlier one
+// has the same effect on the tiles and visits the same cells (so both fit on the board in the same places).
+// Redundant sequences, starting with the immediate reversals such as "LR", become patterns of an
+// Aho-Corasick automaton, and any move that completes a pattern is pruned.
+struct MovePruningAutomaton {
+    static const int MAX_LENGTH = 10;
+    vector<array<int32_t, 4>> next;     // next[state][move], or -1 if the move completes a redundant sequence.
+    int patterns = 0;
+
+    MovePruningAutomaton() {
+        const int SIDE = 2 * MAX_LENGTH + 1, CENTER = MAX_LENGTH * SIDE + MAX_LENGTH;
+        const int step[] = {-SIDE, SIDE, -1, 1};   // Cell offsets on the SIDE x SIDE grid, in BOARD's move order.
+
+        // Trie of the patterns found so far; terminal[] marks states where one ends.
+        vector<array<int32_t, 4>> trie(1, {-1, -1, -1, -1});
+        vector<bool> terminal(1, false);
+        auto add_pattern = [&](const vector<int> &_moves) {
+            int32_t state = 0;
+            for (int m : _moves) {
+                if (trie[state][m] < 0) {
+                    trie[state][m] = trie.size();
+                    trie.push_back({-1, -1, -1, -1});
+                    terminal.push_back(false);
+                }
+                state = trie[state][m];
+            }
+            terminal[state] = true;
+            patterns++;
+        };
+        auto ends_with_pattern = [&](const vector<int> &_moves) {
+            for (size_t start = 0; start < _moves.size(); start++) {
+                int32_t state = 0;
+                for (size_t i = start; i < _moves.size() && state >= 0 && !terminal[state]; i++) {
+                    state = trie[state][_moves[i]];
+                }
+                if (state >= 0 && terminal[state]) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        for (int m = 0; m < 4; m++) {   // Moving straight back is always redundant.
+            add_pattern({m, m ^ 1});
+        }
+
+        // Effect of a sequence: the blank's final cell, the visited cells and where each moved tile ended up.
+        auto effect_of = [&](const vector<int> &_moves) {
+            // Only visited cells can change, so visited cell i now holds tile `tiles[i]` (tiles are named
+            // after their starting cell, the blank is 0xffff). Packed as sorted (cell, tile) pairs.
+            uint32_t cells[MAX_LENGTH+1];
+            uint16_t tiles[MAX_LENGTH+1];
+            int visited = 1, blank = 0;     // blank indexes cells.
+            cells[0] = CENTER;
+            tiles[0] = 0xffff;
+            for (int m : _moves) {
+                uint32_t next_cell = cells[blank] + step[m];
+                int next_blank = find(cells, cells + visited, next_cell) - cells;
+                if (next_blank == visited) {
+                    cells[visited] = next_cell;
+                    tiles[visited++] = next_cell;
+                }
+                swap(tiles[blank], tiles[next_blank]);
+                blank = next_blank;
+            }
+            for (int i = 0; i < visited; i++) {
+                cells[i] = (cells[i] << 16) | tiles[i];
+            }
+            for (int i = 1; i < visited; i++) {     // Insertion sort; there are at most MAX_LENGTH+1 cells.
+                for (int j = i; j > 0 && cells[j-1] > cells[j]; j--) {
+                    swap(cells[j-1], cells[j]);
+                }
+            }
+            return string(reinterpret_cast<const char*>(cells), visited * sizeof(uint32_t));
+        };
+
+        // Grows the surviving sequences one move at a time, in alphabetical order within each length.
+        unordered_set<string> seen_effects = {effect_of({})};
+        vector<vector<int>> level = {{}};
+        for (int length = 1; length <= MAX_LENGTH; length++) {
+            vector<vector<int>> next_level;
+            vector<int> extended;
+            for (const vector<int> &moves : level) {
+                for (int m = 0; m < 4; m++) {
+                    extended.assign(moves.begin(), moves.end());
+                    extended.push_back(m);
+                    if (ends_with_pattern(extended)) {
+                        continue;
+                    }
+                    if (!seen_effects.insert(effect_of(extended)).second) {
+                        add_pattern(extended);  // An earlier sequence already does the same thing.
+                        continue;
+                    }
+                    next_level.push_back(extended);
+                }
+            }
+            level.swap(next_level);
+        }
+
+        // Aho-Corasick: failure links turn the trie into a complete transition table.
+        next.assign(trie.size(), {-1, -1, -1, -1});
+        vector<int32_t> failure(trie.size(), 0);
+        vector<bool> rejected = terminal;
+        deque<int32_t> pending;
+        for (int m = 0; m < 4; m++) {
+            next[0][m] = (trie[0][m] >= 0) ? trie[0][m] : 0;
+            if (trie[0][m] >= 0) {
+                pending.push_back(trie[0][m]);
+            }
+        }
+        while (!pending.empty()) {
+            int32_t state = pending.front();
+            pending.pop_front();
+            rejected[state] = rejected[state] || rejected[failure[state]];
+            for (int m = 0; m < 4; m++) {
+                if (trie[state][m] >= 0) {
+                    failure[trie[state][m]] = next[failure[state]][m];
+                    next[state][m] = trie[state][m];
+                    pending.push_back(trie[state][m]);
+                } else {
+                    next[state][m] = next[failure[state]][m];
+                }
+            }
+        }
+        for (auto &transitions : next) {
+            for (int32_t &target : transitions) {
+                if (rejected[target]) {
+                    target = -1;
+                }
+            }
+        }
+    }
+};
+
+const MovePruningAutomaton& move_pruning_automaton() {
+    static const MovePruningAutomaton automaton;
+    return automaton;
+}
+
+// State shared by the recursive calls of ida_star_search.
+struct IdaStarState {
+    const vector<int>* delta_f;     // nullptr when child heuristics are computed in full (pattern databases).
+    string heuristic_type;
+    SearchLimits* limits;
+    TranspositionTable* table;
+    const MovePruningAutomaton* automaton;  // nullptr when move pruning is off.
+    vector<uint64_t> path;  // Boards from the root to the current node.
+    vector<int8_t> choices; // Which child of each board on the path is being searched.
+    vector<int8_t> resume;  // Choices down to the board a stopped search had reached; replayed on resume.
+    bool resuming = false;
+    int threshold = 0, next_threshold = INT32_MAX;
+    int nodes_expanded = 0, max_depth = 0;
+    long long table_prunes = 0, automaton_prunes = 0, bpmx_prunes = 0;
+    LayerStats layers;
+    bool stopped = false;
+};
+
+// Searches below the last board on the path; returns true once the goal is found. While resuming, the
+// boards along _state.resume were already expanded and counted before the checkpoint, so they only
+// regenerate their children and carry on at the child that was being searched.
+bool ida_star_dfs(IdaStarState &_state, int _blank, int _g, int _h, int32_t _automaton_state, uint64_t _goal) {
+    if (_g + _h > _state.threshold) {
+        _state.next_threshold = min(_state.next_threshold, _g + _h);
+        return false;
+    }
+    uint64_t board = _state.path.back();
+    bool replaying = _state.resuming && _g < (int)_state.resume.size();
+    if (!replaying) {
+        _state.resuming = false;
+        if (board == _goal) {
+            return true;
+        }
+        if (_state.limits->should_stop(_state.nodes_expanded)) {
+            _state.stopped = true;
+            _state.resume = _state.choices;     // Where a resumed search carries on.
+            return false;
+        }
+        if (_g > 0 && _state.table->seen_or_store(board, _g, _state.threshold)) {
+            _state.table_prunes++;
+            return false;
+        }
+        _state.nodes_expanded++;
+        _state.max_depth = max(_state.max_depth, _g);
+        _state.layers.record(_g, _state.threshold);
+        if (expansion_tracer != nullptr) {
+            expansion_tracer->record(board, _blank, _g, _h, _g + _h, _state.path.size());
+        }
+    }
+
+    // Generates the children first so bidirectional pathmax (BPMX) can use their heuristics: a child's h
+    // minus 1 bounds this node, which may push it over the threshold before any child is searched, and
+    // this node's h minus 1 bounds every child. Only inconsistent heuristics benefit.
+    int children = 0;
+    int child_blanks[4], child_hs[4];
+    int32_t child_automaton_states[4];
+    uint64_t child_boards[4];
+    for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+        int new_blank = BOARD.neighbour[_blank][m];
+        if (new_blank < 0) {
+            continue;   // Ignore tiles that are out-of-bounds.
+        }
+        int32_t next_automaton_state = 0;
+        if (_state.automaton != nullptr) {
+            next_automaton_state = _state.automaton->next[_automaton_state][m];
+            if (next_automaton_state < 0) {
+                _state.automaton_prunes += !replaying;
+                continue;   // Some other move sequence reaches the same board at most as deep.
+            }
+        }
+
+        uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+        uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * _blank));
+        if (_state.automaton == nullptr && _state.path.size() >= 2 && new_board == _state.path.end()[-2]) {
+            continue;   // Without the automaton, at least never move straight back.
+        }
+        int new_h;
+        if (_state.delta_f != nullptr) {
+            new_h = _h + (*_state.delta_f)[(tile * PUZZLE_TILES + _blank) * 4 + m] - 1;
+        } else {
+            vector<vector<int>> new_puzzle = unpack_puzzle(new_board);
+            new_h = compute_heuristic(new_puzzle, _state.heuristic_type);
+        }
+        child_blanks[children] = new_blank;
+        child_hs[children] = new_h;
+        child_automaton_states[children] = next_automaton_state;
+        child_boards[children++] = new_board;
+        _h = max(_h, new_h - 1);
+    }
+    if (_g + _h > _state.threshold) {
+        _state.bpmx_prunes++;
+        _state.next_threshold = min(_state.next_threshold, _g + _h);
+        return false;
+    }
+
+    for (int c = replaying ? _state.resume[_g] : 0; c < children; c++) {
+        _state.path.push_back(child_boards[c]);
+        _state.choices.push_back(c);
+        if (ida_star_dfs(_state, child_blanks[c], _g+1, max(child_hs[c], _h - 1), child_automaton_states[c], _goal)) {
+            return true;
+        }
+        _state.path.pop_back();
+        _state.choices.pop_back();
+        _state.resuming = false;
+        if (_state.stopped) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// Memory of a depth-first search: its path and transposition table.
+MemoryUsage ida_star_memory(IdaStarState &_state, TranspositionTable &_table) {
+    MemoryUsage memory;
+    size_t used = _table.used();
+    memory.frontier_bytes = _state.path.capacity() * sizeof(uint64_t);
+    memory.closed_bytes = _table.entries.size() * sizeof(TranspositionTable::Entry);
+    memory.closed_load_factor = _table.entries.empty() ? 0 : (double)used / _table.entries.size();
+    memory.stored_nodes = used + _state.path.size();
+    memory.bounded = true;
+    return memory;
+}
+
+// IDA* checkpoint layout: a header (magic, shape, heuristic, problem), the current and next thresholds,
+// the counters and layer statistics so far, the child chosen at each depth on the way to the board the
+// search stopped at, and the transposition table's entries for the current threshold. Between iterations
+// the choices and table entries are empty. Resuming replays the choices, so the search continues where it
+// stopped and reports the same expansions as one that was never interrupted.
+const string IDA_STAR_CHECKPOINT_MAGIC = "NPZIDA02";
+
+// No threshold of a real checkpoint comes near this: the hardest 4x4 boards take 80 moves. Larger values
+// would only send the resumed recursion deep enough to overflow the stack.
+const int IDA_STAR_MAX_THRESHOLD = 4 * PUZZLE_TILES * (PUZZLE_ROWS + PUZZLE_COLS);
+
+bool is_ida_star_checkpoint(string _path) {
+    ifstream in(_path, ios::binary);
+    string magic(IDA_STAR_CHECKPOINT_MAGIC.size(), ' ');
+    in.read(&magic[0], magic.size());
+    return in && magic == IDA_STAR_CHECKPOINT_MAGIC;
+}
+
+void put_counts(string &_buffer, const vector<long long> &_counts) {
+    put_value<int32_t>(_buffer, _counts.size());
+    for (long long count : _counts) {
+        put_value<int64_t>(_buffer, count);
+    }
+}
+
+bool get_counts(istream &_in, vector<long long> &_counts) {
+    int32_t size = get_value<int32_t>(_in);
+    if (!_in || size < 0 || size > bytes_left(_in) / (int64_t)sizeof(int64_t)) {
+        return false;
+    }
+    _counts.resize(size);
+    for (long long &count : _counts) {
+        count = get_value<int64_t>(_in);
+    }
+    return (bool)_in;
+}
+
+string serialize_ida_star(vector<vector<int>> &_problem, string &_heuristic_type, IdaStarState &_state) {
+    string buffer = IDA_STAR_CHECKPOINT_MAGIC;
+    put_value<int32_t>(buffer, PUZZLE_SHAPE);
+    put_value<int32_t>(buffer, _heuristic_type.size());
+    buffer += _heuristic_type;
+    put_puzzle(buffer, _problem);
+    put_value<int32_t>(buffer, _state.threshold);
+    put_value<int32_t>(buffer, _state.next_threshold);
+    put_value<int32_t>(buffer, _state.nodes_expanded);
+    put_value<int32_t>(buffer, _state.max_depth);
+    put_value<int64_t>(buffer, _state.table_prunes);
+    put_value<int64_t>(buffer, _state.automaton_prunes);
+    put_value<int64_t>(buffer, _state.bpmx_prunes);
+    put_counts(buffer, _state.layers.by_depth);
+    put_counts(buffer, _state.layers.by_f);
+
+    vector<int8_t> resume = _state.stopped ? _state.resume : vector<int8_t>();
+    put_value<int32_t>(buffer, resume.size());
+    buffer.append(resume.begin(), resume.end());
+    TranspositionTable &table = *_state.table;
+    int64_t entries = 0;
+    for (auto &entry : table.entries) {
+        entries += _state.stopped && entry.generation == table.generation && entry.threshold == _state.threshold;
+    }
+    put_value<int64_t>(buffer, entries);
+    for (auto &entry : table.entries) {
+        if (_state.stopped && entry.generation == table.generation && entry.threshold == _state.threshold) {
+            put_value<uint64_t>(buffer, entry.board);
+            put_value<int16_t>(buffer, entry.g);
+        }
+    }
+    return buffer;
+}
+
+// Reads a checkpoint into `_state`, whose transposition table has to be sized already.
+bool load_ida_star_checkpoint(string _path, vector<vector<int>> &_problem, string &_heuristic_type, IdaStarState &_state) {
+    ifstream in(_path, ios::binary);
+    string magic(IDA_STAR_CHECKPOINT_MAGIC.size(), ' ');
+    in.read(&magic[0], magic.size());
+    if (!in || magic != IDA_STAR_CHECKPOINT_MAGIC || get_value<int32_t>(in) != PUZZLE_SHAPE || !get_string(in, _heuristic_type)) {
+        return false;
+    }
+    _problem = get_puzzle(in);
+    _state.threshold = get_value<int32_t>(in);
+    _state.next_threshold = get_value<int32_t>(in);
+    _state.nodes_expanded = get_value<int32_t>(in);
+    _state.max_depth = get_value<int32_t>(in);
+    _state.table_prunes = get_value<int64_t>(in);
+    _state.automaton_prunes = get_value<int64_t>(in);
+    _state.bpmx_prunes = get_value<int64_t>(in);
+    if (!in || !is_tile_permutation(_problem) || _state.threshold < 0 || _state.threshold > IDA_STAR_MAX_THRESHOLD
+        || _state.nodes_expanded < 0 || !get_counts(in, _state.layers.by_depth) || !get_counts(in, _state.layers.by_f)) {
+        return false;
+    }
+
+    int32_t depth = get_value<int32_t>(in);
+    if (!in || depth < 0 || depth > _state.threshold || depth > bytes_left(in)) {
+        return false;
+    }
+    _state.resume.assign(depth, 0);
+    in.read(reinterpret_cast<char*>(_state.resume.data()), depth);
+    for (int8_t choice : _state.resume) {
+        if (choice < 0 || choice >= 4) {
+            return false;
+        }
+    }
+    _state.resuming = !_state.resume.empty();
+    const int64_t ENTRY_BYTES = sizeof(uint64_t) + sizeof(int16_t);
+    int64_t entries = get_value<int64_t>(in);
+    if (!in || entries < 0 || entries > bytes_left(in) / ENTRY_BYTES) {
+        return false;
+    }
+    for (int64_t i = 0; i < entries; i++) {
+        uint64_t board = get_value<uint64_t>(in);
+        int16_t g = get_value<int16_t>(in);
+        if (!_state.table->entries.empty()) {
+            _state.table->slot(board) = {board, _state.table->generation, (int16_t)_state.threshold, g};
+        }
+    }
+    return (bool)in;
+}
+
+// Iterative Deepening A*: repeated depth-first searches bounded by f = g + h, raising the bound to the
+// smallest f that exceeded it. Uses constant memory apart from the fixed-size transposition table.
+// With --checkpoint, the search is saved after every iteration and when it is stopped.
+SearchResult ida_star_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    TranspositionTable &table = context.table;
+    table.resize(options.transposition_entries);
+    IdaStarState state;
+    state.table = &table;
+    state.threshold = -1;
+    if (!options.resume_path.empty()) {     // Carries on where the checkpointed search stopped.
+        if (!load_ida_star_checkpoint(options.resume_path, problem, heuristic_type, state)) {
+            cout << "Unable to resume from checkpoint \"" << options.resume_path << "\"." << '\n' << '\n';
+            return result;
+        }
+        if (options.verbose) {
+            cout << "Resumed " << heuristic_type << " at threshold " << state.threshold << " after "
+                 << state.nodes_expanded << " expanded nodes." << '\n' << '\n';
+        }
+    }
+    static const vector<int> manhattan_delta_f = build_delta_f_table("Manhattan");
+    static const vector<int> misplaced_delta_f = build_delta_f_table("Misplaced");
+
+    uint8_t tiles[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        tiles[i] = problem[i / PUZZLE_COLS][i % PUZZLE_COLS];
+    }
+    if (!is_solvable_tiles(tiles)) {    // IDA* would otherwise deepen forever.
+        if (options.verbose) {
+            print_failure();
+        }
+        return result;
+    }
+
+    if (heuristic_type.find("Manhattan") != string::npos) {
+        state.delta_f = &manhattan_delta_f;
+    } else if (heuristic_type.find("Misplaced") != string::npos) {
+        state.delta_f = &misplaced_delta_f;
+    } else {
+        state.delta_f = nullptr;
+    }
+    state.heuristic_type = heuristic_type;
+    state.limits = &limits;
+    state.automaton = options.move_pruning ? &move_pruning_automaton() : nullptr;
+    state.path = {pack_puzzle(problem)};
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    int root_h = compute_heuristic(problem, heuristic_type);
+    const uint64_t goal = pack_puzzle(PUZZLE_GOAL);
+
+    if (options.resume_path.empty()) {
+        state.threshold = root_h;
+    }
+    auto save_checkpoint = [&]() {
+        if (!options.checkpoint_path.empty()) {
+            write_file_atomically(options.checkpoint_path, serialize_ida_star(problem, heuristic_type, state));
+        }
+    };
+    bool found = false;
+    while (!found) {
+        found = ida_star_dfs(state, x_blank * PUZZLE_COLS + y_blank, 0, root_h, 0, goal);
+        if (state.stopped) {
+            save_checkpoint();  // Keeps the path to the board the search stopped at, so no work is repeated.
+            if (options.verbose && !options.checkpoint_path.empty()) {
+                cout << "Checkpoint saved to \"" << options.checkpoint_path << "\"." << '\n';
+            }
+            result.lower_bound = state.threshold;   // Every path cheaper than the threshold was ruled out.
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = state.nodes_expanded;
+            result.q_max_size = state.max_depth;
+            result.memory = ida_star_memory(state, table);
+            result.layers = state.layers;
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+        if (!found) {
+            state.threshold = state.next_threshold;
+            state.next_threshold = INT32_MAX;
+            save_checkpoint();
+        }
+    }
+
+    PuzzleNode* goal_node = rebuild_path(state.path, heuristic_type);
+    if (options.verbose) {
+        print_puzzle_path(goal_node);
+        print_summary(goal_node->g, state.nodes_expanded, state.max_depth);
+        cout << "Transposition table prunes: " << state.table_prunes << " (" << table.entries.size() << " entries)" << '\n'
+             << "Move pruning automaton prunes: " << state.automaton_prunes;
+        if (state.automaton != nullptr) {
+            cout << " (" << state.automaton->next.size() << " states, " << state.automaton->patterns << " redundant sequences)";
+        }
+        cout << '\n';
+        if (state.bpmx_prunes > 0) {
+            cout << "BPMX prunes: " << state.bpmx_prunes << '\n';
+        }
+        cout << '\n';
+    }
+    result.solved = true;
+    result.depth = goal_node->g;
+    result.lower_bound = goal_node->g;
+    result.moves = trace_moves(goal_node);
+    delete_path(goal_node);
+    result.nodes_expanded = state.nodes_expanded;
+    result.q_max_size = state.max_depth;
+    result.memory = ida_star_memory(state, table);
+    result.layers = state.layers;
+    return result;
+}
+
+// Lane-parallel IDA* for batches of small puzzles, where per-solve setup would otherwise dominate. Each
+// of LANES lanes runs its own depth-first search on an explicit stack, and every step advances all lanes
+// by one move: first lane_children() computes every lane's next child from the tops of the stacks, then
+// each lane pushes, pops or finishes. A lane whose job is done takes the next queued job. Moves straight
+// back are skipped; the transposition table and move-pruning automaton are not used.
+const int LANE_MAX_DEPTH = 128;     // More than any optimal 4x4 solution needs.
+
+// The child step gathers from tables and shifts each lane's board by its own amount, which needs AVX2 to
+// vectorize; on x86-64 it is compiled twice and the loader picks the AVX2 copy where the CPU has it. The
+// tables are passed __restrict, since otherwise GCC cannot rule out that they overlap the lane arrays.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(__clang__)
+#define LANE_VECTOR_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define LANE_VECTOR_CLONES
+#endif
+
+template <int LANES>
+struct LaneStacks {
+    // The node on top of every stack and the move to try next from it, by lane, so the child step reads
+    // and writes contiguous arrays. parent_blank is -1 at the root.
+    uint64_t top_board[LANES];
+    int32_t top_h[LANES], top_blank[LANES], top_move[LANES], parent_blank[LANES];
+    // What lane_children() makes of them; `skip` marks moves off the board or straight back.
+    uint64_t child_board[LANES];
+    int32_t child_h[LANES], child_blank[LANES], skip[LANES];
+
+    // The stacks themselves, for backtracking and for reading a solution's moves.
+    uint64_t boards[LANES][LANE_MAX_DEPTH];
+    int16_t hs[LANES][LANE_MAX_DEPTH];
+    int8_t blanks[LANES][LANE_MAX_DEPTH];
+    int8_t next_moves[LANES][LANE_MAX_DEPTH];   // The next move to try at each depth, one past the move taken.
+    int depth[LANES], max_depth[LANES], threshold[LANES], next_threshold[LANES];
+    long long nodes[LANES];
+    int job[LANES];     // Index into the batch order, or -1 once the lane has retired.
+};
+
+// Every lane's next child, computed without branches; retired lanes just recompute a stale one.
+// `_neighbours` holds the blank's cell after each move, or -1 off the board; `_delta_h` the change in
+// Manhattan distance for each tile, blank cell and move.
+template <int LANES>
+LANE_VECTOR_CLONES void lane_children(LaneStacks<LANES> &_s, const int32_t* __restrict _neighbours,
+                                      const int32_t* __restrict _delta_h) {
+    for (int l = 0; l < LANES; l++) {
+        int32_t m = _s.top_move[l] & 3, blank = _s.top_blank[l];
+        int32_t neighbour = _neighbours[blank * 4 + m];
+        int32_t new_blank = neighbour < 0 ? blank : neighbour;
+        uint64_t board = _s.top_board[l];
+        uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+        _s.child_board[l] = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));
+        _s.child_h[l] = _s.top_h[l] + _delta_h[((int32_t)tile * PUZZLE_TILES + blank) * 4 + m];
+        _s.child_blank[l] = new_blank;
+        _s.skip[l] = (neighbour < 0) | (new_blank == _s.parent_blank[l]);
+    }
+}
+
+template <int LANES>
+void lane_ida_star_run(vector<BatchJob> &_jobs, vector<int> &_order, atomic<size_t> &_next_job, SearchOptions &_options,
+                       chrono::steady_clock::time_point _batch_start) {
+    const string directions = "UDLR";
+
+    static const vector<int> delta_f = build_delta_f_table("Manhattan");
+    int32_t neighbours[PUZZLE_TILES * 4];
+    for (int cell = 0; cell < PUZZLE_TILES; cell++) {
+        for (int m = 0; m < 4; m++) {
+            neighbours[cell * 4 + m] = BOARD.neighbour[cell][m];
+        }
+    }
+    vector<int32_t> delta_h(delta_f.size());
+    for (size_t i = 0; i < delta_f.size(); i++) {
+        delta_h[i] = (delta_f[i] == INT32_MAX) ? 0 : delta_f[i] - 1;
+    }
+    const uint64_t goal = pack_puzzle(PUZZLE_GOAL);
+
+    unique_ptr<LaneStacks<LANES>> stacks(new LaneStacks<LANES>());
+    LaneStacks<LANES> &s = *stacks;
+    vector<SearchLimits> limits(LANES, SearchLimits(_options));
+    auto since_start_ms = [&_batch_start]() {
+        chrono::duration<double, milli> d = chrono::steady_clock::now() - _batch_start;
+        return d.count();
+    };
+
+    // Copies the node at depth _d of a lane's stack to the top arrays, with the next move to try from it.
+    auto load_top = [&](int _lane, int _d) {
+        s.top_board[_lane] = s.boards[_lane][_d];
+        s.top_h[_lane] = s.hs[_lane][_d];
+        s.top_blank[_lane] = s.blanks[_lane][_d];
+        s.top_move[_lane] = s.next_moves[_lane][_d];
+        s.parent_blank[_lane] = _d > 0 ? s.blanks[_lane][_d-1] : -1;
+    };
+    // Records a lane's result; a solved lane's moves are the moves taken at each depth of its stack.
+    auto retire = [&](int _lane, bool _solved, string _stop_reason) {
+        BatchJob &job = _jobs[_order[s.job[_lane]]];
+        job.result.solved = _solved;
+        job.result.stop_reason = _stop_reason;
+        job.result.depth = _solved ? s.depth[_lane] : -1;
+        job.result.lower_bound = _solved ? s.depth[_lane] : s.threshold[_lane];
+        job.result.nodes_expanded = s.nodes[_lane];
+        job.result.q_max_size = s.max_depth[_lane];
+        job.result.moves.clear();
+        for (int d = 0; _solved && d < s.depth[_lane]; d++) {
+            job.result.moves += directions[s.next_moves[_lane][d] - 1];
+        }
+        job.run_ms = since_start_ms() - job.wait_ms;
+        s.job[_lane] = -1;
+    };
+    // Loads the next queued job into a lane, or leaves it retired when the queue is empty.
+    auto refill = [&](int _lane) {
+        for (size_t n = _next_job++; n < _order.size(); n = _next_job++) {
+            BatchJob &job = _jobs[_order[n]];
+            job.wait_ms = since_start_ms();
+            if (!job.solvable) {
+                continue;
+            }
+            int x_blank, y_blank;
+            locate_blank(job.puzzle, x_blank, y_blank);
+            s.job[_lane] = n;
+            s.boards[_lane][0] = pack_puzzle(job.puzzle);
+            s.blanks[_lane][0] = x_blank * PUZZLE_COLS + y_blank;
+            s.hs[_lane][0] = manhattan_distance(job.puzzle);
+            s.next_moves[_lane][0] = 0;
+            s.depth[_lane] = s.max_depth[_lane] = 0;
+            s.threshold[_lane] = s.hs[_lane][0];
+            s.next_threshold[_lane] = INT32_MAX;
+            s.nodes[_lane] = 1;     // The root.
+            limits[_lane] = SearchLimits(_options);
+            load_top(_lane, 0);
+            if (s.boards[_lane][0] == goal) {
+                retire(_lane, true, "");
+                continue;
+            }
+            return;
+        }
+        s.job[_lane] = -1;
+    };
+
+    int active = 0;
+    for (int l = 0; l < LANES; l++) {
+        refill(l);
+        active += (s.job[l] >= 0);
+    }
+    while (active > 0) {
+        lane_children(s, neighbours, delta_h.data());
+
+        for (int l = 0; l < LANES; l++) {
+            if (s.job[l] < 0) {
+                continue;
+            }
+            int d = s.depth[l];
+            if (s.top_move[l] == 4) {   // Every move from this node has been tried.
+                if (d > 0) {
+                    s.depth[l]--;
+                    load_top(l, d-1);
+                } else {    // The pass is over; the next one starts at the smallest f that exceeded this one.
+                    s.threshold[l] = s.next_threshold[l];
+                    s.next_threshold[l] = INT32_MAX;
+                    s.top_move[l] = 0;
+                    s.nodes[l]++;
+                }
+                continue;
+            }
+            s.top_move[l]++;
+            if (s.skip[l]) {
+                continue;   // Off the board, or straight back.
+            }
+            int f = d + 1 + s.child_h[l];
+            if (f > s.threshold[l] || d+1 >= LANE_MAX_DEPTH) {
+                s.next_threshold[l] = min(s.next_threshold[l], f);
+                continue;
+            }
+            s.next_moves[l][d] = s.top_move[l];
+            s.depth[l] = d+1;
+            s.max_depth[l] = max(s.max_depth[l], d+1);
+            s.boards[l][d+1] = s.child_board[l];
+            s.hs[l][d+1] = s.child_h[l];
+            s.blanks[l][d+1] = s.child_blank[l];
+            s.next_moves[l][d+1] = 0;
+            s.parent_blank[l] = s.top_blank[l];
+            s.top_board[l] = s.child_board[l];
+            s.top_h[l] = s.child_h[l];
+            s.top_blank[l] = s.child_blank[l];
+            s.top_move[l] = 0;
+            bool stopped = false;
+            if (s.child_board[l] == goal) {
+                retire(l, true, "");
+            } else if (limits[l].should_stop(++s.nodes[l])) {
+                retire(l, false, limits[l].stop_reason);
+                stopped = true;
+            }
+            if (s.job[l] < 0) {
+                refill(l);
+                active -= (s.job[l] < 0);
+            }
+            if (stopped && _options.cancel_token != nullptr && _options.cancel_token->load()) {
+                _next_job = _order.size();  // Cancelled: the queued jobs stay unsolved.
+            }
+        }
+    }
+}
+
+// Runs lane-parallel IDA* with 8 or 16 lanes until the batch queue is empty.
+void lane_ida_star_batch(vector<BatchJob> &_jobs, vector<int> &_order, atomic<size_t> &_next_job, SearchOptions _options,
+                         int _lanes, chrono::steady_clock::time_point _batch_start) {
+    if (_lanes <= 8) {
+        lane_ida_star_run<8>(_jobs, _order, _next_job, _options, _batch_start);
+    } else {
+        lane_ida_star_run<16>(_jobs, _order, _next_job, _options, _batch_start);
+    }
+}
+
+
+// Manhattan distance of a packed board, summed from the shape's per-tile, per-position table.
+int packed_manhattan(uint64_t _board) {
+    int dist = 0;
+    for (int pos = 0; pos < PUZZLE_TILES; pos++) {
+        dist += BOARD.manhattan[(_board >> (4 * pos)) & 0xf][pos];
+    }
+    return dist;
+}
+
+// Every state within `depth` moves of the goal with its exact distance, from one backward breadth-first
+// search. Stored in a flat open-addressing table (a packed board of 0 marks an empty slot, since no legal
+// board packs to 0), so its memory use is exactly capacity * 9 bytes.
+struct PerimeterTable {
+    int depth = 0;
+    vector<uint64_t> boards;
+    vector<uint8_t> distances;
+    size_t count = 0;
+
+    size_t slot(uint64_t _board) const {
+        size_t mask = boards.size() - 1;
+        size_t i = (_board * 0x9e3779b97f4a7c15ULL >> 20) & mask;
+        while (boards[i] != 0 && boards[i] != _board) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    // Exact distance to the goal, or -1 if the board lies outside the perimeter.
+    int distance(uint64_t _board) const {
+        size_t i = slot(_board);
+        return (boards[i] == 0) ? -1 : distances[i];
+    }
+
+    size_t memory_bytes() const {
+        return boards.size() * (sizeof(uint64_t) + sizeof(uint8_t));
+    }
+
+    PerimeterTable(int _depth) : depth(_depth) {
+        vector<uint64_t> layer = {pack_puzzle(PUZZLE_GOAL)}, all = layer;
+        vector<uint8_t> all_distances = {0};
+        unordered_set<uint64_t> seen(layer.begin(), layer.end());
+        for (int d = 1; d <= depth && !layer.empty(); d++) {
+            vector<uint64_t> next_layer;
+            for (uint64_t board : layer) {
+                int blank = 0;
+                while ((board >> (4 * blank)) & 0xf) {
+                    blank++;
+                }
+                for (int m = 0; m < 4; m++) {
+                    int new_blank = BOARD.neighbour[blank][m];
+                    if (new_blank < 0) {
+                        continue;
+                    }
+                    uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+                    uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));
+                    if (seen.insert(new_board).second) {
+                        next_layer.push_back(new_board);
+                        all.push_back(new_board);
+                        all_distances.push_back(d);
+                    }
+                }
+            }
+            layer.swap(next_layer);
+        }
+
+        size_t capacity = 16;
+        while (capacity < all.size() * 2) {
+            capacity *= 2;
+        }
+        boards.assign(capacity, 0);
+        distances.assign(capacity, 0);
+        for (size_t n = 0; n < all.size(); n++) {
+            size_t i = slot(all[n]);
+            boards[i] = all[n];
+            distances[i] = all_distances[n];
+        }
+        count = all.size();
+    }
+};
+
+// Perimeter tables are built once per depth and then only read, so batch and server threads share them.
+const PerimeterTable& perimeter_table(int _depth) {
+    static mutex tables_lock;
+    static map<int, unique_ptr<PerimeterTable>> tables;
+    lock_guard<mutex> guard(tables_lock);
+    unique_ptr<PerimeterTable> &table = tables[_depth];
+    if (!table) {
+        table.reset(new PerimeterTable(_depth));
+    }
+    return *table;
+}
+
+// Perimeter search: A* towards a precomputed neighbourhood of the goal instead of the goal itself. Inside
+// the perimeter h is the exact stored distance; outside it h is max(Manhattan, perimeter depth + 1), since
+// any state outside is more than that many moves away. The search stops as soon as the best solution
+// through a generated perimeter state is no worse than the smallest f left in the queue.
+SearchResult perimeter_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    const PerimeterTable &perimeter = perimeter_table(options.perimeter_depth);
+    auto estimate = [&](uint64_t _board) {
+        int exact = perimeter.distance(_board);
+        return (exact >= 0) ? exact : max(packed_manhattan(_board), perimeter.depth + 1);
+    };
+    auto search_memory = [&]() {    // The compact modes' structures, plus the perimeter table.
+        MemoryUsage memory = compact_search_memory(context);
+        memory.heuristic_bytes = perimeter.memory_bytes();
+        return memory;
+    };
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    CompactNodeStore &nodes = context.nodes;
+    vector<uint64_t> &q = context.frontier;     // Min-heap maintained with push_heap/pop_heap.
+    StampedClosedSet &puzzle_visits = context.closed;
+    uint64_t root = pack_puzzle(problem);
+    nodes.add(root, 0, x_blank * PUZZLE_COLS + y_blank, 0);
+    q.push_back(make_compact_key(estimate(root), 0, 0));
+
+    // Best solution through the perimeter so far: its length and the node where it touched the perimeter.
+    int best_length = INT32_MAX;
+    uint32_t best_node = 0;
+    if (perimeter.distance(root) >= 0) {
+        best_length = perimeter.distance(root);
+    }
+
+    int nodes_expanded = 0, q_max_size = 1;
+    while (!q.empty() && (int)(q.front() >> 56) < best_length) {
+        q_max_size = max(q_max_size, (int)q.size());    // Track largest queue size.
+
+        if (nodes.full()) {
+            limits.stop_reason = "node store full";
+        }
+        if (!limits.stop_reason.empty() || limits.should_stop(nodes_expanded)) {
+            result.lower_bound = q.front() >> 56;   // f of the best queued node.
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = search_memory();
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+
+        pop_heap(q.begin(), q.end(), greater<uint64_t>());
+        uint32_t index = (uint32_t)(q.back() & 0xffffffffffffULL);
+        q.pop_back();
+        int g = nodes.gs[index], blank = nodes.blanks[index];
+        uint64_t board = nodes.boards[index];
+        if (!puzzle_visits.insert(board)) {     // Skip already visited nodes.
+            continue;
+        }
+        nodes_expanded++;
+
+        for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+            int new_blank = BOARD.neighbour[blank][m];
+            if (new_blank < 0) {
+                continue;   // Ignore tiles that are out-of-bounds.
+            }
+            uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+            uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));
+            uint32_t child = nodes.add(new_board, index, new_blank, g+1);
+            int exact = perimeter.distance(new_board);
+            if (exact >= 0 && g + 1 + exact < best_length) {    // Touched the perimeter.
+                best_length = g + 1 + exact;
+                best_node = child;
+            }
+            q.push_back(make_compact_key(g + 1 + estimate(new_board), g+1, child));
+            push_heap(q.begin(), q.end(), greater<uint64_t>());
+        }
+    }
+    q_max_size = max(q_max_size, (int)q.size());
+
+    if (options.verbose) {
+        cout << "Perimeter depth " << perimeter.depth << ": " << perimeter.count << " states, "
+             << perimeter.memory_bytes() << " bytes" << '\n' << '\n';
+    }
+    if (best_length == INT32_MAX) {
+        if (options.verbose) {
+            print_failure();    // Unsuccessful search.
+        }
+        result.nodes_expanded = nodes_expanded;
+        result.q_max_size = q_max_size;
+        result.memory = search_memory();
+        return result;
+    }
+
+    // The forward half comes from parent links; the rest walks down the perimeter's distances to the goal.
+    vector<uint64_t> path = {nodes.boards[best_node]};
+    for (uint32_t i = best_node; nodes.parents[i] != i; i = nodes.parents[i]) {
+        path.push_back(nodes.boards[nodes.parents[i]]);
+    }
+    reverse(path.begin(), path.end());
+    for (int d = perimeter.distance(path.back()); d > 0; d--) {
+        uint64_t board = path.back();
+        int blank = 0;
+        while ((board >> (4 * blank)) & 0xf) {
+            blank++;
+        }
+        for (int m = 0; m < 4; m++) {
+            int cell = BOARD.neighbour[blank][m];
+            if (cell < 0) {
+                continue;
+            }
+            uint64_t tile = (board >> (4 * cell)) & 0xf;
+            uint64_t new_board = board ^ (tile << (4 * cell)) ^ (tile << (4 * blank));
+            if (perimeter.distance(new_board) == d - 1) {
+                path.push_back(new_board);
+                break;
+            }
+        }
+    }
+
+    PuzzleNode* goal_node = rebuild_path(path, heuristic_type);
+    if (options.verbose) {
+        print_puzzle_path(goal_node);
+        print_summary(goal_node->g, nodes_expanded, q_max_size);
+    }
+    result.solved = true;
+    result.depth = goal_node->g;
+    result.lower_bound = goal_node->g;
+    result.moves = trace_moves(goal_node);
+    delete_path(goal_node);
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = q_max_size;
+    result.memory = search_memory();
+    return result;
+}
+
+
+// Additive pattern database: for one group of tiles, the fewest moves of those tiles (moves of the other
+// tiles are free) that bring them to their goal cells, from every placement of the group. Distances are
+// indexed by rank_cells() of the group's cells. The groups split the tiles, so their sum is admissible.
+struct PatternDatabase {
+    vector<int> tiles;
+    vector<uint8_t> distances;
+    vector<uint8_t> state_mod3;     // Distance modulo 3 of every state of the group plus the blank, 4 per byte.
+
+    uint64_t checksum() const {     // FNV-1a over the distances, to compare builds.
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (uint8_t d : distances) {
+            hash = (hash ^ d) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+};
+
+// Numbers every placement of `count` distinct cells, in order, from 0 to n!/(n-count)!-1.
+uint64_t rank_cells(const int* _cells, int _count) {
+    uint64_t rank = 0;
+    for (int i = 0; i < _count; i++) {
+        int smaller_before = 0;
+        for (int j = 0; j < i; j++) {
+            smaller_before += _cells[j] < _cells[i];
+        }
+        rank = rank * (PUZZLE_TILES - i) + _cells[i] - smaller_before;
+    }
+    return rank;
+}
+
+void unrank_cells(uint64_t _rank, int* _cells, int _count) {
+    for (int i = _count-1; i >= 0; i--) {
+        _cells[i] = _rank % (PUZZLE_TILES - i);
+        _rank /= (PUZZLE_TILES - i);
+    }
+    bool used[PUZZLE_TILES] = {};
+    for (int i = 0; i < _count; i++) {
+        int cell = 0;
+        for (int skip = _cells[i]; used[cell] || skip > 0; cell++) {
+            skip -= !used[cell];
+        }
+        used[cell] = true;
+        _cells[i] = cell;
+    }
+}
+
+uint64_t count_placements(int _count) {
+    uint64_t placements = 1;
+    for (int i = 0; i < _count; i++) {
+        placements *= PUZZLE_TILES - i;
+    }
+    return placements;
+}
+
+// Builds a pattern database by breadth-first search backwards from the goal over the group's cells plus
+// the blank's, with `threads` threads. Each layer first spreads its distance over moves of other tiles
+// (free), pass after pass until nothing changes, then one more pass moves group tiles to seed the next
+// layer. A pass splits the state table into chunks that the threads claim in turn. States are 4-bit
+// entries, two per byte, set with compare-and-swap; they hold the distance modulo 15 (15 means unseen),
+// which is enough to tell the current layer apart because an old layer's neighbours are all seen already.
+// The exact distance of each placement of the group is written once, when first reached, so the result
+// does not depend on the number of threads.
+PatternDatabase build_pattern_database(vector<int> _tiles, int _threads, bool _verbose) {
+    const int k = _tiles.size();
+    const uint64_t states = count_placements(k + 1), CHUNK = 1 << 14;
+    unique_ptr<atomic<uint8_t>[]> nibbles(new atomic<uint8_t>[(states + 1) / 2]);
+    unique_ptr<atomic<uint8_t>[]> distances(new atomic<uint8_t>[count_placements(k)]);
+    for (uint64_t i = 0; i < (states + 1) / 2; i++) {
+        nibbles[i].store(0xff, memory_order_relaxed);
+    }
+    for (uint64_t i = 0; i < count_placements(k); i++) {
+        distances[i].store(255, memory_order_relaxed);
+    }
+    auto get = [&](uint64_t _state) {
+        return (nibbles[_state / 2].load(memory_order_relaxed) >> (4 * (_state & 1))) & 0xf;
+    };
+    auto try_set = [&](uint64_t _state, int _value) {   // Sets an unseen state; false if it was seen already.
+        atomic<uint8_t> &byte = nibbles[_state / 2];
+        int shift = 4 * (_state & 1);
+        uint8_t old = byte.load(memory_order_relaxed);
+        while (((old >> shift) & 0xf) == 0xf) {
+            if (byte.compare_exchange_weak(old, (old & ~(0xf << shift)) | (_value << shift), memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    int cells[PUZZLE_TILES + 1];
+    for (int i = 0; i < k; i++) {
+        cells[i] = find(goal_tiles().begin(), goal_tiles().end(), _tiles[i]) - goal_tiles().begin();
+    }
+    cells[k] = find(goal_tiles().begin(), goal_tiles().end(), 0) - goal_tiles().begin();
+    try_set(rank_cells(cells, k + 1), 0);
+    distances[rank_cells(cells, k)].store(0, memory_order_relaxed);
+
+    // One pass over the table: expands every state of layer `depth` with either free or group moves.
+    auto pass = [&](int _depth, bool _group_moves, atomic<uint64_t> &_added) {
+        atomic<uint64_t> next_chunk(0);
+        auto work = [&]() {
+            int state_cells[PUZZLE_TILES + 1];
+            uint64_t added = 0;
+            for (uint64_t begin; (begin = next_chunk.fetch_add(CHUNK)) < states; ) {
+                for (uint64_t state = begin; state < min(states, begin + CHUNK); state++) {
+                    if (get(state) != _depth % 15) {
+                        continue;
+                    }
+                    unrank_cells(state, state_cells, k + 1);
+                    int blank = state_cells[k];
+                    for (int m = 0; m < 4; m++) {
+                        int target = BOARD.neighbour[blank][m];
+                        if (target < 0) {
+                            continue;   // Ignore tiles that are out-of-bounds.
+                        }
+                        int tile = find(state_cells, state_cells + k, target) - state_cells;
+                        if ((tile < k) != _group_moves) {
+                            continue;
+                        }
+                        if (tile < k) {
+                            state_cells[tile] = blank;
+                        }
+                        state_cells[k] = target;
+                        int value = _group_moves ? _depth + 1 : _depth;
+                        if (try_set(rank_cells(state_cells, k + 1), value % 15)) {
+                            added++;
+                            uint8_t unseen = 255;
+                            distances[rank_cells(state_cells, k)].compare_exchange_strong(unseen, value, memory_order_relaxed);
+                        }
+                        if (tile < k) {
+                            state_cells[tile] = target;
+                        }
+                        state_cells[k] = blank;
+                    }
+                }
+            }
+            _added += added;
+        };
+        vector<thread> workers;
+        for (int t = 1; t < _threads; t++) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (thread &worker : workers) {
+            worker.join();
+        }
+    };
+
+    uint64_t seen = 0, layer = 1;   // States in the finished layers, and in the current one.
+    for (int depth = 0; ; depth++) {
+        auto start = chrono::steady_clock::now();
+        atomic<uint64_t> added(0);
+        do {    // Free moves until the layer is closed.
+            layer += added.exchange(0);
+            pass(depth, false, added);
+        } while (added.load() > 0);
+        pass(depth, true, added);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        seen += layer;
+        if (_verbose) {
+            cout << "  layer " << setw(2) << depth << ": " << setw(10) << layer << " states, "
+                 << fixed << setprecision(1) << setw(5) << 100.0 * seen / states << "% seen, "
+                 << setprecision(3) << elapsed.count() << " ms" << defaultfloat << '\n';
+        }
+        if (added.load() == 0) {
+            break;
+        }
+        layer = added.load();
+    }
+
+    PatternDatabase database;
+    database.tiles = _tiles;
+    database.distances.resize(count_placements(k));
+    for (uint64_t i = 0; i < database.distances.size(); i++) {
+        database.distances[i] = distances[i].load(memory_order_relaxed);
+    }
+    database.state_mod3.assign((states + 3) / 4, 0);
+    for (uint64_t state = 0; state < states; state++) {
+        int value = get(state);     // Distance modulo 15, and 15 divides by 3.
+        database.state_mod3[state / 4] |= (value == 15 ? 3 : value % 3) << (2 * (state & 3));
+    }
+    return database;
+}
+
+// The groups of tiles the databases are built for: consecutive tiles, 4 per group on 3x3 boards and 5
+// on larger ones, so each table stays small enough to build at start-up.
+vector<vector<int>> pattern_groups() {
+    const int group_size = PUZZLE_TILES <= 9 ? 4 : 5;
+    vector<vector<int>> groups;
+    for (int tile = 1; tile < PUZZLE_TILES; tile++) {
+        if ((tile - 1) % group_size == 0) {
+            groups.emplace_back();
+        }
+        groups.back().push_back(tile);
+    }
+    return groups;
+}
+
+// Built once on first use with every hardware thread and shared by all searches.
+const vector<PatternDatabase>& pattern_databases() {
+    static const vector<PatternDatabase> databases = []() {
+        vector<PatternDatabase> built;
+        for (vector<int> &group : pattern_groups()) {
+            built.push_back(build_pattern_database(group, max(1u, thread::hardware_concurrency()), false));
+        }
+        return built;
+    }();
+    return databases;
+}
+
+// A pattern database in one of three storages:
+//   "none":       one byte per placement of the group, as built.
+//   "min":        one byte per `block` consecutive ranks (placements that only differ in the last tile's
+//                 cell), holding their minimum; smaller, still admissible, but weaker.
+//   "blank-mod3": the distance modulo 3 of every state of the group plus the blank, 2 bits each. Moves
+//                 change that distance by at most one, so the exact value is recovered by walking a
+//                 shortest path to the goal and counting the steps (see lookup_mod3()). Knowing where the
+//                 blank is makes it stronger than "none", but it is not a compression: with n cells and
+//                 k tiles per group it takes (n-k)/4 bytes per placement, 2.75 times "none" on 4x4, and
+//                 every lookup walks the path.
+struct CompressedPatternDatabase {
+    vector<int> tiles;
+    string compression;
+    int block = 1;
+    vector<uint8_t> entries;
+
+    int lookup(const int* _cell_of) const {     // _cell_of[tile] is the cell of each tile, blank included.
+        int cells[PUZZLE_TILES + 1];
+        for (size_t i = 0; i < tiles.size(); i++) {
+            cells[i] = _cell_of[tiles[i]];
+        }
+        if (compression == "blank-mod3") {
+            cells[tiles.size()] = _cell_of[0];
+            return lookup_mod3(cells);
+        }
+        return entries[rank_cells(cells, tiles.size()) / block];
+    }
+
+    int mod3(const int* _cells) const {
+        uint64_t state = rank_cells(_cells, tiles.size() + 1);
+        return (entries[state / 4] >> (2 * (state & 3))) & 3;
+    }
+
+    // Each round floods the blank through the cells the group does not occupy (free moves keep the
+    // distance), stops if that reaches the goal, and otherwise takes a group move whose state is one lower
+    // modulo 3, which makes it exactly one lower.
+    int lookup_mod3(int* _cells) const {
+        const int k = tiles.size();
+        const int goal_blank = find(goal_tiles().begin(), goal_tiles().end(), 0) - goal_tiles().begin();
+        for (int h = 0; ; h++) {
+            bool occupied[PUZZLE_TILES] = {}, reached[PUZZLE_TILES] = {}, at_goal = true;
+            for (int i = 0; i < k; i++) {
+                occupied[_cells[i]] = true;
+                at_goal = at_goal && goal_tiles()[_cells[i]] == tiles[i];
+            }
+            int region[PUZZLE_TILES], size = 0;
+            region[size++] = _cells[k];
+            reached[_cells[k]] = true;
+            for (int r = 0; r < size; r++) {
+                for (int m = 0; m < 4; m++) {
+                    int cell = BOARD.neighbour[region[r]][m];
+                    if (cell >= 0 && !occupied[cell] && !reached[cell]) {
+                        reached[cell] = true;
+                        region[size++] = cell;
+                    }
+                }
+            }
+            if (at_goal && reached[goal_blank]) {
+                return h;
+            }
+
+            int lower = (mod3(_cells) + 2) % 3;
+            bool stepped = false;
+            for (int r = 0; r < size && !stepped; r++) {
+                for (int m = 0; m < 4 && !stepped; m++) {
+                    int cell = BOARD.neighbour[region[r]][m];
+                    if (cell < 0 || !occupied[cell]) {
+                        continue;
+                    }
+                    int tile = find(_cells, _cells + k, cell) - _cells;
+                    _cells[tile] = region[r];   // The group tile slides into the blank.
+                    _cells[k] = cell;
+                    stepped = mod3(_cells) == lower;
+                    if (!stepped) {
+                        _cells[tile] = cell;
+                    }
+                }
+            }
+            if (!stepped) {
+                return 0;   // Only if the table is corrupt; 0 keeps the heuristic admissible.
+            }
+        }
+    }
+
+    size_t memory_bytes() const {
+        return entries.size();
+    }
+};
+
+// Compressed copies of the pattern databases, built on first use for each storage and block size.
+const vector<CompressedPatternDatabase>& compressed_pattern_databases(string _compression, int _block) {
+    static mutex databases_lock;
+    static map<pair<string, int>, vector<CompressedPatternDatabase>> databases;
+    lock_guard<mutex> guard(databases_lock);
+    vector<CompressedPatternDatabase> &compressed = databases[{_compression, _compression == "min" ? _block : 1}];
+    if (!compressed.empty()) {
+        return compressed;
+    }
+    for (const PatternDatabase &database : pattern_databases()) {
+        CompressedPatternDatabase c;
+        c.tiles = database.tiles;
+        c.compression = _compression;
+        if (_compression == "blank-mod3") {
+            c.entries = database.state_mod3;
+        } else if (_compression == "min") {
+            c.block = max(1, _block);
+            c.entries.assign((database.distances.size() + c.block - 1) / c.block, 255);
+            for (size_t rank = 0; rank < database.distances.size(); rank++) {
+                c.entries[rank / c.block] = min(c.entries[rank / c.block], database.distances[rank]);
+            }
+        } else {
+            c.compression = "none";
+            c.entries = database.distances;
+        }
+        compressed.push_back(c);
+    }
+    return compressed;
+}
+
+// Bytes of the pattern databases in the storage selected for the PDB heuristics.
+size_t pattern_database_memory() {
+    size_t bytes = 0;
+    for (const CompressedPatternDatabase &database : compressed_pattern_databases(pattern_database_compression, pattern_database_block)) {
+        bytes += database.memory_bytes();
+    }
+    return bytes;
+}
+
+// Sum of the pattern databases. With _symmetric it is the maximum of three such sums, for the board, its
+// reflection in the main diagonal (relabeled so the goal maps onto itself, like GoalMapping) and, when the
+// blank is on its goal cell, its dual (tile t goes to t's goal cell, labeled with the tile whose goal is
+// t's cell; the dual is the same distance from the goal only when the blank is home). Every lookup is
+// admissible, so their maximum is too, and it needs no extra memory.
+int pattern_database_heuristic(vector<vector<int>> &_p, bool _symmetric) {
+    const vector<CompressedPatternDatabase> &databases = compressed_pattern_databases(pattern_database_compression, pattern_database_block);
+    auto sum = [&](const int* _cell_of) {
+        int h = 0;
+        for (const CompressedPatternDatabase &database : databases) {
+            h += database.lookup(_cell_of);
+        }
+        return h;
+    };
+    int cell_of[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        cell_of[_p[i / PUZZLE_COLS][i % PUZZLE_COLS]] = i;
+    }
+    int h = sum(cell_of);
+    if (!_symmetric) {
+        return h;
+    }
+
+    static const GoalMapping reflection = []() {
+        GoalMapping mapping;
+        mapping.symmetry = 1;
+        mapping.relabel.assign(PUZZLE_TILES, 0);
+        for (int i = 0; i < PUZZLE_ROWS && PUZZLE_ROWS == PUZZLE_COLS; i++) {  // Only square boards have a diagonal.
+            for (int j = 0; j < PUZZLE_COLS; j++) {
+                mapping.relabel[PUZZLE_GOAL[i][j]] = PUZZLE_GOAL[j][i];
+            }
+        }
+        return mapping;
+    }();
+    const int goal_blank = find(goal_tiles().begin(), goal_tiles().end(), 0) - goal_tiles().begin();
+    if (PUZZLE_ROWS == PUZZLE_COLS && reflection.relabel[0] == 0) {   // The goal's blank is on the diagonal, so the reflection keeps the goal.
+        int reflected_cell_of[PUZZLE_TILES];
+        for (int tile = 0; tile < PUZZLE_TILES; tile++) {
+            int x = cell_of[tile] / PUZZLE_COLS, y = cell_of[tile] % PUZZLE_COLS;
+            reflected_cell_of[reflection.relabel[tile]] = y * PUZZLE_COLS + x;
+        }
+        h = max(h, sum(reflected_cell_of));
+    }
+    if (cell_of[0] == goal_blank) {
+        int dual_cell_of[PUZZLE_TILES];
+        for (int tile = 0; tile < PUZZLE_TILES; tile++) {
+            int goal_cell = find(goal_tiles().begin(), goal_tiles().end(), tile) - goal_tiles().begin();
+            dual_cell_of[goal_tiles()[cell_of[tile]]] = goal_cell;
+        }
+        h = max(h, sum(dual_cell_of));
+    }
+    return h;
+}
+
+// Part of --benchmark for the pattern database modes: compares every storage by table size, heuristic
+// lookups per millisecond on random boards, and nodes expanded and time over the premade puzzles.
+void print_pattern_database_benchmark(vector<string> _heuristic_types, SearchOptions _options, SearchContext &_context) {
+    vector<vector<vector<int>>> boards(100000, vector<vector<int>>(PUZZLE_ROWS, vector<int>(PUZZLE_COLS)));
+    mt19937_64 rng(1);
+    for (vector<vector<int>> &board : boards) {
+        vector<int> tiles(goal_tiles().begin(), goal_tiles().end());
+        shuffle(tiles.begin(), tiles.end(), rng);
+        for (int i = 0; i < PUZZLE_TILES; i++) {
+            board[i / PUZZLE_COLS][i % PUZZLE_COLS] = tiles[i];
+        }
+    }
+    string saved_compression = pattern_database_compression;
+    int saved_block = pattern_database_block;
+    cout << '\n' << "storage     lookups      bytes  lookups_per_ms  nodes_expanded  milliseconds" << '\n';
+    for (pair<string, int> storage : vector<pair<string, int>>{{"none", 1}, {"min", 2}, {"min", 4}, {"blank-mod3", 1}}) {
+        pattern_database_compression = storage.first;
+        pattern_database_block = storage.second;
+        size_t bytes = 0;
+        for (const CompressedPatternDatabase &database : compressed_pattern_databases(storage.first, storage.second)) {
+            bytes += database.memory_bytes();
+        }
+        for (string heuristic_type : _heuristic_types) {
+            long long checksum = 0;     // Keeps the lookups from being optimized away.
+            auto start = chrono::steady_clock::now();
+            for (vector<vector<int>> &board : boards) {
+                checksum += compute_heuristic(board, heuristic_type);
+            }
+            chrono::duration<double, milli> lookup_time = chrono::steady_clock::now() - start;
+
+            long long nodes_expanded = 0;
+            start = chrono::steady_clock::now();
+            for (int difficulty = 0; difficulty <= 9; difficulty++) {
+                nodes_expanded += _context.solve(init_premade_initial_puzzle(difficulty), heuristic_type, _options).nodes_expanded;
+            }
+            chrono::duration<double, milli> search_time = chrono::steady_clock::now() - start;
+
+            string label = storage.first == "min" ? "min/" + to_string(storage.second) : storage.first;
+            cout << left << setw(10) << label << "  " << setw(7) << (heuristic_type.find("Max") != string::npos ? "max" : "plain")
+                 << right << "  " << setw(9) << bytes << "  " << setw(14) << fixed << setprecision(1)
+                 << (checksum >= 0 ? boards.size() / lookup_time.count() : 0.0) << "  " << setw(14) << nodes_expanded
+                 << "  " << setw(12) << setprecision(3) << search_time.count() << defaultfloat << '\n';
+        }
+    }
+    pattern_database_compression = saved_compression;
+    pattern_database_block = saved_block;
+}
+
+// Handles "--build-pdb [--threads T] [--verify]": builds every pattern database with T threads (all
+// hardware threads by default), reporting each layer, and with --verify also builds them serially and
+// checks that both builds match byte for byte.
+int run_pdb_builder(int argc, char* argv[]) {
+    int threads = max(1u, thread::hardware_concurrency());
+    bool verify = false;
+    for (int i = 2; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--verify") {
+            verify = true;
+        } else if (i+1 < argc && flag == "--threads") {
+            threads = max(1, atoi(argv[++i]));
+        }
+    }
+
+    bool identical = true;
+    for (vector<int> &group : pattern_groups()) {
+        cout << "Pattern";
+        for (int tile : group) {
+            cout << ' ' << tile;
+        }
+        cout << " (" << count_placements(group.size() + 1) << " states, " << threads << " threads)" << '\n';
+        auto start = chrono::steady_clock::now();
+        PatternDatabase database = build_pattern_database(group, threads, true);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        cout << "  built in " << fixed << setprecision(3) << elapsed.count() << " ms, checksum " << hex
+             << database.checksum() << dec << defaultfloat << '\n';
+
+        if (verify) {
+            start = chrono::steady_clock::now();
+            PatternDatabase serial = build_pattern_database(group, 1, false);
+            elapsed = chrono::steady_clock::now() - start;
+            bool same = serial.distances == database.distances && serial.state_mod3 == database.state_mod3;
+            identical = identical && same;
+            cout << "  serial build in " << fixed << setprecision(3) << elapsed.count() << " ms, checksum " << hex
+                 << serial.checksum() << dec << defaultfloat << (same ? " (identical)" : " (DIFFERENT)") << '\n';
+
+            // The blank-mod3 storage must give back every exact distance: the best over all blank cells is the
+            // stored distance of the placement.
+            CompressedPatternDatabase mod3;
+            mod3.tiles = group;
+            mod3.compression = "blank-mod3";
+            mod3.entries = database.state_mod3;
+            uint64_t wrong = 0;
+            int cells[PUZZLE_TILES + 1];
+            for (uint64_t rank = 0; rank < database.distances.size(); rank++) {
+                int best = INT32_MAX;
+                for (int blank = 0; blank < PUZZLE_TILES; blank++) {
+                    unrank_cells(rank, cells, group.size());
+                    if (find(cells, cells + group.size(), blank) == cells + group.size()) {
+                        cells[group.size()] = blank;
+                        best = min(best, mod3.lookup_mod3(cells));
+                    }
+                }
+                wrong += best != database.distances[rank];
+            }
+            identical = identical && wrong == 0;
+            cout << "  blank-mod3 storage: " << wrong << " of " << database.distances.size() << " distances decoded wrongly" << '\n';
+        }
+    }
+    return identical ? 0 : 1;
+}
+
+
+// Beam search: breadth-first by layers, keeping only the beam_width children with the lowest h in each
+// layer. Every layer's children go into one flat buffer allocated up front, so memory is bounded by
+// beam_width nodes per layer and each layer costs the same. Neither optimal nor complete: a beam that is
+// too narrow can run out of unvisited boards.
+SearchResult beam_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    static const vector<int> manhattan_delta_f = build_delta_f_table("Manhattan");
+    static const vector<int> misplaced_delta_f = build_delta_f_table("Misplaced");
+    const vector<int> &delta_f = (heuristic_type.find("Manhattan") != string::npos) ? manhattan_delta_f : misplaced_delta_f;
+
+    const int width = max(1, options.beam_width);
+    vector<uint64_t> child_keys(4 * width);     // h in the high 32 bits, then the child's slot in the buffer.
+    vector<uint64_t> child_boards(4 * width);
+    vector<uint32_t> child_parents(4 * width);
+    vector<uint8_t> child_blanks(4 * width), child_hs(4 * width);
+    StampedClosedSet layer_seen;                // Children already in the buffer for this layer.
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    const uint64_t goal = pack_puzzle(PUZZLE_GOAL);
+    CompactNodeStore &nodes = context.nodes;    // Every kept node, layer after layer.
+    StampedClosedSet &kept = context.closed;
+    vector<uint8_t> hs = {(uint8_t)compute_heuristic(problem, heuristic_type)};
+    nodes.add(pack_puzzle(problem), 0, x_blank * PUZZLE_COLS + y_blank, 0);
+    kept.insert(nodes.boards[0]);
+    auto search_memory = [&]() {    // The layer buffer is the frontier; the kept nodes and their h are the arena.
+        MemoryUsage memory = compact_search_memory(context);
+        memory.frontier_bytes = child_keys.capacity() * (2 * sizeof(uint64_t) + sizeof(uint32_t) + 2 * sizeof(uint8_t));
+        memory.closed_bytes += layer_seen.memory_bytes();
+        memory.arena_bytes += hs.capacity() * sizeof(uint8_t);
+        return memory;
+    };
+
+    int nodes_expanded = 0, q_max_size = 1;
+    int goal_index = nodes.boards[0] == goal ? 0 : -1;
+    uint32_t layer_begin = 0, layer_end = 1;
+    while (goal_index < 0 && layer_begin < layer_end && nodes.gs[layer_begin] < 255) {  // g is stored in a byte.
+        if (limits.should_stop(nodes_expanded)) {
+            result.lower_bound = hs[0];     // A beam proves nothing beyond the root's heuristic.
+            result.stop_reason = limits.stop_reason;
+            result.nodes_expanded = nodes_expanded;
+            result.q_max_size = q_max_size;
+            result.memory = search_memory();
+            if (options.verbose) {
+                print_stopped(result);
+            }
+            return result;
+        }
+
+        int count = 0;
+        layer_seen.clear();
+        for (uint32_t index = layer_begin; index < layer_end && goal_index < 0; index++) {
+            nodes_expanded++;
+            uint64_t board = nodes.boards[index];
+            int blank = nodes.blanks[index];
+            for (int m = 0; m < 4; m++) {   // Considers all possible moves for the blank tile.
+                int new_blank = BOARD.neighbour[blank][m];
+                if (new_blank < 0) {
+                    continue;   // Ignore tiles that are out-of-bounds.
+                }
+                uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+                uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));  // Slides the tile into the blank.
+                if (kept.contains(new_board) || !layer_seen.insert(new_board)) {
+                    continue;   // Skip boards kept in an earlier layer or already generated in this one.
+                }
+                child_boards[count] = new_board;
+                child_parents[count] = index;
+                child_blanks[count] = new_blank;
+                child_hs[count] = hs[index] + delta_f[(tile * PUZZLE_TILES + blank) * 4 + m] - 1;
+                child_keys[count] = ((uint64_t)child_hs[count] << 32) | count;
+                if (new_board == goal) {    // Goal test on generation; no need to finish the layer.
+                    child_keys[0] = child_keys[count];
+                    count = 1;
+                    goal_index = nodes.boards.size();
+                    break;
+                }
+                count++;
+            }
+        }
+        q_max_size = max(q_max_size, count);
+
+        // Keeps the best beam_width children; keys are unique, so the choice is deterministic.
+        int keep = min(count, width);
+        nth_element(child_keys.begin(), child_keys.begin() + keep, child_keys.begin() + count);
+        sort(child_keys.begin(), child_keys.begin() + keep);
+        layer_begin = nodes.boards.size();
+        for (int k = 0; k < keep; k++) {
+            uint32_t slot = child_keys[k] & 0xffffffff;
+            nodes.add(child_boards[slot], child_parents[slot], child_blanks[slot], nodes.gs[child_parents[slot]] + 1);
+            hs.push_back(child_hs[slot]);
+            kept.insert(child_boards[slot]);
+        }
+        layer_end = nodes.boards.size();
+    }
+
+    if (goal_index < 0) {
+        if (options.verbose) {
+            print_failure();    // Unsuccessful search.
+        }
+        result.nodes_expanded = nodes_expanded;
+        result.q_max_size = q_max_size;
+        result.memory = search_memory();
+        return result;
+    }
+    vector<uint64_t> path = {goal};
+    for (uint32_t i = goal_index; nodes.parents[i] != i; i = nodes.parents[i]) {
+        path.push_back(nodes.boards[nodes.parents[i]]);
+    }
+    reverse(path.begin(), path.end());
+    PuzzleNode* curr = rebuild_path(path, heuristic_type);
+    if (options.verbose) {
+        print_puzzle_path(curr);
+        print_summary(curr->g, nodes_expanded, q_max_size);
+        cout << "Beam width: " << width << ", nodes kept: " << nodes.boards.size() << '\n' << '\n';
+    }
+    result.solved = true;
+    result.depth = curr->g;
+    result.lower_bound = hs[0];
+    result.moves = trace_moves(curr);
+    delete_path(curr);
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = q_max_size;
+    result.memory = search_memory();
+    return result;
+}
+
+// Cost-to-go estimate of a board from a lookahead of `depth` more moves (never straight back to the previous
+// blank position). Every board's own h (the learned one if there is one, Manhattan distance otherwise) is
+// also a lower bound, so the estimate never drops below it; otherwise a short loop of boards whose learned
+// values only show up inside the lookahead would never get any better, and the agent would cycle forever.
+int lrta_lookahead(uint64_t _board, int _blank, int _prev_blank, int _depth, uint64_t _goal,
+                   unordered_map<uint64_t, int> &_learned_h, int &_nodes_expanded) {
+    if (_board == _goal) {
+        return 0;
+    }
+    auto learned = _learned_h.find(_board);
+    int h = learned != _learned_h.end() ? learned->second : packed_manhattan(_board);
+    if (_depth == 0) {
+        return h;
+    }
+    _nodes_expanded++;
+    int best = INT32_MAX;
+    for (int m = 0; m < 4; m++) {
+        int new_blank = BOARD.neighbour[_blank][m];
+        if (new_blank < 0 || new_blank == _prev_blank) {
+            continue;
+        }
+        uint64_t tile = (_board >> (4 * new_blank)) & 0xf;
+        uint64_t new_board = _board ^ (tile << (4 * new_blank)) ^ (tile << (4 * _blank));
+        best = min(best, 1 + lrta_lookahead(new_board, new_blank, _blank, _depth - 1, _goal, _learned_h, _nodes_expanded));
+    }
+    return max(h, best);
+}
+
+// Learning Real-Time A* (LRTA*): commits to one move at a time after a lookahead of fixed depth, so each
+// move costs at most 4 * 3^(lookahead-1) expansions however hard the puzzle is. Before each move the current
+// board's h is raised to its best lookahead value. The learned values are kept in the context, so every
+// trial (and every later solve on the same context) follows a better path, converging to an optimal one.
+// A solve that finds more than options.learned_limit values in the context starts over without them, so a
+// long-lived context stays bounded; values are never dropped during a solve, which could keep it from ending.
+// Loops in a trial's path are cut out, and the shortest path of all trials is reported.
+SearchResult lrta_star_search(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    SearchLimits limits(options);
+    SearchResult result;
+    if (!packed_boards_fit()) {
+        return result;
+    }
+    uint8_t tiles[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        tiles[i] = problem[i / PUZZLE_COLS][i % PUZZLE_COLS];
+    }
+    if (!is_solvable_tiles(tiles)) {    // LRTA* would otherwise wander forever.
+        if (options.verbose) {
+            print_failure();
+        }
+        return result;
+    }
+
+    int x_blank, y_blank;   // Coordinates for the blank tile.
+    locate_blank(problem, x_blank, y_blank);
+    const uint64_t root = pack_puzzle(problem), goal = pack_puzzle(PUZZLE_GOAL);
+    unordered_map<uint64_t, int> &learned_h = context.learned_h;
+    if (options.learned_limit > 0 && (long long)learned_h.size() > options.learned_limit) {
+        learned_h.clear();  // Starts learning over; Manhattan distances alone are still admissible.
+    }
+    const int lookahead = max(1, options.lookahead);
+
+    int nodes_expanded = 0;
+    vector<uint64_t> path, best_path;
+    // The learned values are the closed set, counted with libstdc++'s node layout (a next pointer and the pair;
+    // integer keys cache no hash); the paths and the
+    // current trial's path index are the arena.
+    auto search_memory = [&](const unordered_map<uint64_t, size_t> &_path_index) {
+        MemoryUsage memory;
+        memory.closed_bytes = learned_h.bucket_count() * sizeof(void*)
+                            + learned_h.size() * (sizeof(void*) + sizeof(pair<const uint64_t, int>));
+        memory.closed_load_factor = learned_h.load_factor();
+        memory.arena_bytes = (path.capacity() + best_path.capacity()) * sizeof(uint64_t)
+                           + _path_index.bucket_count() * sizeof(void*)
+                           + _path_index.size() * (sizeof(void*) + sizeof(pair<const uint64_t, size_t>));
+        memory.stored_nodes = learned_h.size();
+        return memory;
+    };
+    for (int trial = 1; trial <= max(1, options.trials); trial++) {
+        uint64_t board = root;
+        int blank = x_blank * PUZZLE_COLS + y_blank, moves = 0;
+        path = {root};
+        unordered_map<uint64_t, size_t> path_index = {{root, 0}};
+        while (board != goal) {
+            if (limits.should_stop(nodes_expanded)) {
+                auto learned = learned_h.find(root);
+                result.lower_bound = learned != learned_h.end() ? learned->second : packed_manhattan(root);
+                result.stop_reason = limits.stop_reason;
+                result.nodes_expanded = nodes_expanded;
+                result.q_max_size = learned_h.size();
+                result.memory = search_memory(path_index);
+                if (options.verbose) {
+                    print_stopped(result);
+                }
+                return result;
+            }
+
+            // Scores every move by its lookahead, learns from the best and takes it.
+            int best = INT32_MAX, best_blank = -1;
+            uint64_t best_board = 0;
+            for (int m = 0; m < 4; m++) {
+                int new_blank = BOARD.neighbour[blank][m];
+                if (new_blank < 0) {
+                    continue;   // Ignore tiles that are out-of-bounds.
+                }
+                uint64_t tile = (board >> (4 * new_blank)) & 0xf;
+                uint64_t new_board = board ^ (tile << (4 * new_blank)) ^ (tile << (4 * blank));
+                int value = 1 + lrta_lookahead(new_board, new_blank, blank, lookahead - 1, goal, learned_h, nodes_expanded);
+                if (value < best) {
+                    best = value;
+                    best_blank = new_blank;
+                    best_board = new_board;
+                }
+            }
+            nodes_expanded++;
+            auto learned = learned_h.find(board);
+            int h = learned != learned_h.end() ? learned->second : packed_manhattan(board);
+            learned_h[board] = max(h, best);
+
+            board = best_board;
+            blank = best_blank;
+            moves++;
+            auto seen = path_index.find(board);
+            if (seen != path_index.end()) {     // Back on the path: cut the loop out.
+                for (size_t i = seen->second + 1; i < path.size(); i++) {
+                    path_index.erase(path[i]);
+                }
+                path.resize(seen->second + 1);
+            } else {
+                path_index[board] = path.size();
+                path.push_back(board);
+            }
+        }
+        if (options.verbose) {
+            cout << "Trial " << trial << ": " << moves << " moves, " << path.size() - 1 << " without loops" << '\n';
+        }
+        if (best_path.empty() || path.size() < best_path.size()) {
+            best_path = path;
+        }
+    }
+
+    PuzzleNode* curr = rebuild_path(best_path, heuristic_type);
+    if (options.verbose) {
+        cout << '\n';
+        print_puzzle_path(curr);
+        print_summary(curr->g, nodes_expanded, learned_h.size());
+        cout << "Learned heuristic values: " << learned_h.size() << '\n' << '\n';
+    }
+    result.solved = true;
+    result.depth = curr->g;
+    result.lower_bound = packed_manhattan(root);
+    result.moves = trace_moves(curr);
+    delete_path(curr);
+    result.nodes_expanded = nodes_expanded;
+    result.q_max_size = learned_h.size();
+    result.memory = search_memory({});
+    return result;
+}
+
+
+// Position of (row, column) under symmetry s: bit 0 swaps the axes, bit 1 mirrors rows, bit 2 mirrors columns.
+// Swapping the axes only keeps square boards on the board, so the other shapes have just the 4 mirrorings.
+pair<int, int> apply_symmetry(int _s, int _r, int _c) {
+    if (_s & 1) {
+        swap(_r, _c);
+    }
+    if (_s & 2) {
+        _r = PUZZLE_ROWS - 1 - _r;
+    }
+    if (_s & 4) {
+        _c = PUZZLE_COLS - 1 - _c;
+    }
+    return {_r, _c};
+}
+
+vector<vector<int>> apply_goal_mapping(GoalMapping &_mapping, vector<vector<int>> &_p) {
+    vector<vector<int>> mapped(PUZZLE_ROWS, vector<int>(PUZZLE_COLS));
+    for (int i = 0; i < PUZZLE_ROWS; i++) {
+        for (int j = 0; j < PUZZLE_COLS; j++) {
+            pair<int, int> cell = apply_symmetry(_mapping.symmetry, i, j);
+            mapped[cell.first][cell.second] = _mapping.relabel[_p[i][j]];
+        }
+    }
+    return mapped;
+}
+
+// Finds the mapping for a goal; false if the goal is not a permutation of the tiles or its blank is not
+// in a position some symmetry can move onto PUZZLE_GOAL's blank. Costs O(n) per goal.
+bool map_goal(vector<vector<int>> &_goal, GoalMapping &_mapping) {
+    int x_blank, y_blank, goal_x_blank, goal_y_blank;
+    locate_blank(_goal, x_blank, y_blank);
+    vector<vector<int>> standard_goal = PUZZLE_GOAL;
+    locate_blank(standard_goal, goal_x_blank, goal_y_blank);
+    if (_goal.size() != (size_t)PUZZLE_ROWS || _goal[x_blank][y_blank] != 0) {
+        return false;
+    }
+    for (int s = 0; s < 8; s++) {
+        if ((s & 1 && PUZZLE_ROWS != PUZZLE_COLS) || apply_symmetry(s, x_blank, y_blank) != make_pair(goal_x_blank, goal_y_blank)) {
+            continue;
+        }
+        _mapping.symmetry = s;
+        _mapping.relabel.assign(PUZZLE_TILES, -1);
+        for (int i = 0; i < PUZZLE_ROWS; i++) {
+            for (int j = 0; j < PUZZLE_COLS; j++) {
+                pair<int, int> cell = apply_symmetry(s, i, j);
+                int tile = _goal[i][j];
+                if (tile < 0 || tile >= PUZZLE_TILES || _mapping.relabel[tile] != -1) {
+                    return false;
+                }
+                _mapping.relabel[tile] = PUZZLE_GOAL[cell.first][cell.second];
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// Every move swaps the blank with a neighbour: one transposition of the board's cells, which also takes the
+// blank to the other colour of a checkerboard. So a board reaches a goal, wherever its blank is, exactly
+// when the permutation from the goal's cells to the board's has the parity of the blank's Manhattan distance.
+bool is_solvable_for_goal(vector<vector<int>> &_p, vector<vector<int>> &_goal) {
+    int board_cell[PUZZLE_TILES], goal_cell[PUZZLE_TILES];
+    for (int i = 0; i < PUZZLE_TILES; i++) {
+        board_cell[_p[i / PUZZLE_COLS][i % PUZZLE_COLS]] = i;
+        goal_cell[_goal[i / PUZZLE_COLS][i % PUZZLE_COLS]] = i;
+    }
+    int cycles = 0;
+    bool seen[PUZZLE_TILES] = {};
+    for (int tile = 0; tile < PUZZLE_TILES; tile++) {
+        if (seen[tile]) {
+            continue;
+        }
+        cycles++;
+        for (int t = tile; !seen[t]; t = _goal[board_cell[t] / PUZZLE_COLS][board_cell[t] % PUZZLE_COLS]) {
+            seen[t] = true;
+        }
+    }
+    int blank_distance = abs(board_cell[0] / PUZZLE_COLS - goal_cell[0] / PUZZLE_COLS)
+                       + abs(board_cell[0] % PUZZLE_COLS - goal_cell[0] % PUZZLE_COLS);
+    return (PUZZLE_TILES - cycles) % 2 == blank_distance % 2;
+}
+
+// Solves a query with a non-standard goal through its mapping onto PUZZLE_GOAL, then translates the moves
+// back and replays them on the original board for printing. A goal that no symmetry maps there, such as
+// one with its blank in the centre, is searched for directly by general_search with heuristics measured
+// from the goal itself; the modes that need PUZZLE_GOAL's tables run as A* Manhattan then.
+SearchResult solve_for_goal(vector<vector<int>> problem, string heuristic_type, SearchOptions options, SearchContext &context) {
+    if (!is_tile_permutation(options.goal)) {
+        if (options.verbose) {
+            cout << "The goal must be a valid puzzle." << '\n' << '\n';
+        }
+        return SearchResult();
+    }
+    GoalMapping mapping;
+    if (!map_goal(options.goal, mapping)) {
+        if (!is_solvable_for_goal(problem, options.goal)) {     // Saves searching the whole half of the states in vain.
+            if (options.verbose) {
+                print_failure();
+            }
+            return SearchResult();
+        }
+        const set<string> goal_relative = {"Uniform Cost Search", "A* Misplaced", "A* Manhattan", "Weighted A* Manhattan"};
+        if (!goal_relative.count(heuristic_type)) {
+            if (options.verbose) {
+                cout << heuristic_type << " needs a goal with its blank in a corner; using A* Manhattan instead." << '\n' << '\n';
+            }
+            heuristic_type = "A* Manhattan";
+            options.weight = 1.0;
+        }
+        context.reset();
+        SearchResult result = general_search(problem, heuristic_type, options, context);
+        context.queue.heap().clear();
+        return result;
+    }
+    vector<vector<int>> goal = options.goal;
+    bool verbose = options.verbose;
+    options.goal.clear();
+    options.verbose = false;
+    SearchResult result = context.solve(apply_goal_mapping(mapping, problem), heuristic_type, options);
+
+    // A move's direction maps like any vector under the symmetry, so each mapped move is translated back
+    // to the original direction that the symmetry sends onto it.
+    const string directions = "UDLR";
+    string original_moves;
+    for (char move : result.moves) {
+        int mapped = directions.find(move);
+        for (int m = 0; m < 4; m++) {
+            pair<int, int> origin = apply_symmetry(mapping.symmetry, 1, 1);
+            pair<int, int> moved = apply_symmetry(mapping.symmetry, 1 + BOARD.move_x[m], 1 + BOARD.move_y[m]);
+            if (moved.first - origin.first == BOARD.move_x[mapped] && moved.second - origin.second == BOARD.move_y[mapped]) {
+                original_moves += directions[m];
+            }
+        }
+    }
+    result.moves = original_moves;
+
+    if (verbose) {
+        if (!result.solved) {
+            if (result.stop_reason.empty()) {
+                print_failure();
+            } else {
+                print_stopped(result);
+            }
+            return result;
+        }
+        int x_blank, y_blank;
+        locate_blank(problem, x_blank, y_blank);
+        vector<vector<int>> curr_puzzle = problem;
+        auto node_h = [&](vector<vector<int>> &_p) {
+            vector<vector<int>> mapped = apply_goal_mapping(mapping, _p);
+            return compute_heuristic(mapped, heuristic_type);
+        };
+        PuzzleNode* curr = new PuzzleNode(curr_puzzle, x_blank, y_blank, 0, node_h(curr_puzzle), nullptr);
+        for (char move : result.moves) {
+            int cell = BOARD.neighbour[x_blank * PUZZLE_COLS + y_blank][directions.find(move)];
+            swap(curr_puzzle[x_blank][y_blank], curr_puzzle[cell / PUZZLE_COLS][cell % PUZZLE_COLS]);
+            x_blank = cell / PUZZLE_COLS;
+            y_blank = cell % PUZZLE_COLS;
+            curr = new PuzzleNode(curr_puzzle, x_blank, y_blank, curr->g + 1, node_h(curr_puzzle), curr);
+        }
+        if (curr_puzzle != goal) {
+            cout << "Internal error: the mapped solution does not reach the goal." << '\n';
+        }
+        print_puzzle_path(curr);
+        delete_path(curr);
+        print_summary(result.depth, result.nodes_expanded, result.q_max_size);
+    }
+    return result;
+}
+
+
+// Board of any size up to 10x10 for the reduction solver, independent of the compiled-in shape. Cells are
+// numbered row-major; the goal has tile c+1 on cell c and the blank on the last cell. Every move is
+// recorded as the blank's direction (U/D/L/R, like trace_moves()).
+struct LargeBoard {
+    int rows = 0, cols = 0;
+    vector<int> tiles;
+    int blank = 0;
+    string moves;
+
+    void move_blank(int _to) {
+        moves += _to == blank - cols ? 'U' : _to == blank + cols ? 'D' : _to == blank - 1 ? 'L' : 'R';
+        swap(tiles[blank], tiles[_to]);
+        blank = _to;
+    }
+
+    int find(int _tile) {
+        return std::find(tiles.begin(), tiles.end(), _tile) - tiles.begin();
+    }
+};
+
+// Breadth-first search over the cells of a few tracked tiles plus the blank, where the blank may only use
+// _free cells and pushes a tracked tile when it steps onto it. Following the states instead of one tile's
+// route keeps dead ends next to locked cells from trapping the blank. Plays the shortest sequence of moves
+// that satisfies _done on the board; false if none exists.
+bool reduction_search(LargeBoard &_b, vector<int> _tracked, vector<bool> &_free, function<bool(vector<int>&, int)> _done) {
+    // States are stored as keys (blank, then the tracked cells, in base cells). Small state spaces, as for
+    // a single tile, get a flat seen table; larger ones a hash set.
+    const int cells = _b.rows * _b.cols, tracked = _tracked.size();
+    uint64_t tracked_space = 1;     // At most 100^8 for the last 3x3 region of a 10x10 board.
+    for (int t = 0; t < tracked; t++) {
+        tracked_space *= cells;
+    }
+    bool flat = tracked_space <= (1u << 20) / cells;
+    auto key = [&](vector<int> &_cells, int _blank) {
+        uint64_t k = _blank;
+        for (int c : _cells) {
+            k = k * cells + c;
+        }
+        return k;
+    };
+    vector<bool> seen_flat(flat ? tracked_space * cells : 0, false);
+    unordered_set<uint64_t> seen_hashed;
+    auto first_visit = [&](uint64_t _key) {
+        if (!flat) {
+            return seen_hashed.insert(_key).second;
+        }
+        bool first = !seen_flat[_key];
+        seen_flat[_key] = true;
+        return first;
+    };
+
+    vector<uint64_t> keys = {key(_tracked, _b.blank)};
+    vector<int> parents = {-1};
+    first_visit(keys[0]);
+    vector<int> cells_of(tracked), moved(tracked);
+    for (size_t i = 0; i < keys.size(); i++) {
+        uint64_t k = keys[i];
+        for (int t = tracked - 1; t >= 0; t--) {
+            cells_of[t] = k % cells;
+            k /= cells;
+        }
+        int blank = k;
+        if (_done(cells_of, blank)) {
+            vector<int> path;
+            for (int j = i; j > 0; j = parents[j]) {
+                path.push_back(keys[j] / tracked_space);
+            }
+            for (int p = path.size() - 1; p >= 0; p--) {
+                _b.move_blank(path[p]);
+            }
+            return true;
+        }
+        int r = blank / _b.cols, c = blank % _b.cols;
+        int neighbours[] = {r > 0 ? blank - _b.cols : -1, r+1 < _b.rows ? blank + _b.cols : -1,
+                            c > 0 ? blank - 1 : -1, c+1 < _b.cols ? blank + 1 : -1};
+        for (int next : neighbours) {
+            if (next < 0 || !_free[next]) {
+                continue;
+            }
+            for (int t = 0; t < tracked; t++) {
+                moved[t] = cells_of[t] == next ? blank : cells_of[t];
+            }
+            uint64_t child = key(moved, next);
+            if (first_visit(child)) {
+                keys.push_back(child);
+                parents.push_back(i);
+            }
+        }
+    }
+    return false;
+}
+
+// Places the goal tiles of _line (cells of the region's first row or column, in order) and locks them.
+// _perp steps from the line into the rest of the region. All but the last two tiles are moved straight to
+// their cells. The last two cannot be placed one after the other without disturbing the first, so they are
+// gathered in a small window at the end of the line (a 3x3 block minus the locked corner, or 2x3 at the
+// region's edge) and arranged together there.
+void reduction_place_line(LargeBoard &_b, vector<int> &_line, int _perp, vector<bool> &_free) {
+    int n = _line.size();
+    for (int k = 0; k < n-2; k++) {
+        int target = _line[k];
+        reduction_search(_b, {_b.find(target + 1)}, _free, [&](vector<int> &_t, int) { return _t[0] == target; });
+        _free[target] = false;
+    }
+
+    int p = _line[n-2], q = _line[n-1], along = q - p;
+    vector<int> window = {p, q, p + _perp, q + _perp, p + 2*_perp, q + 2*_perp};
+    if (n > 2) {
+        window.push_back(p - along + _perp);
+        window.push_back(p - along + 2*_perp);
+    }
+    auto in_window = [&](int _cell) {
+        return std::find(window.begin(), window.end(), _cell) != window.end();
+    };
+
+    // a goes to the line's last cell first, then b and the blank are brought next to it.
+    reduction_search(_b, {_b.find(p + 1)}, _free, [&](vector<int> &_t, int) { return _t[0] == q; });
+    _free[q] = false;
+    if (!in_window(_b.find(q + 1))) {
+        reduction_search(_b, {_b.find(q + 1)}, _free, [&](vector<int> &_t, int) { return _t[0] == q + 2*_perp; });
+    }
+    _free[_b.find(q + 1)] = false;
+    reduction_search(_b, {}, _free, [&](vector<int>&, int _blank) { return in_window(_blank); });
+    _free[_b.find(q + 1)] = true;
+    _free[q] = true;
+
+    vector<bool> window_free(_free.size(), false);
+    for (int cell : window) {
+        window_free[cell] = true;
+    }
+    reduction_search(_b, {_b.find(p + 1), _b.find(q + 1)}, window_free,
+                     [&](vector<int> &_t, int) { return _t[0] == p && _t[1] == q; });
+    _free[p] = _free[q] = false;
+}
+
+// Solves a board by reduction: places the region's top row or left column (whichever is longer), shrinks
+// the region and repeats until it is at most 3x3, which is solved optimally. Not optimal overall, but
+// linear in the number of tiles per placement, so even 10x10 boards take milliseconds. Adjacent moves that
+// undo each other are cancelled afterwards. Returns the moves, or "" if a placement failed.
+string reduction_solve(LargeBoard &_b, SearchContext &_context) {
+    int top = 0, left = 0;
+    vector<bool> free_cells(_b.rows * _b.cols, true);
+    while (_b.rows - top > 3 || _b.cols - left > 3) {
+        vector<int> line;
+        if (_b.rows - top >= _b.cols - left) {
+            for (int c = left; c < _b.cols; c++) {
+                line.push_back(top * _b.cols + c);
+            }
+            reduction_place_line(_b, line, _b.cols, free_cells);
+            top++;
+        } else {
+            for (int r = top; r < _b.rows; r++) {
+                line.push_back(r * _b.cols + left);
+            }
+            reduction_place_line(_b, line, 1, free_cells);
+            left++;
+        }
+    }
+
+    // The last region's goal is the end of the board's goal, so a region of the compiled-in shape relabels
+    // onto PUZZLE_GOAL and reuses compact A*. Other regions are searched directly.
+    int height = _b.rows - top, width = _b.cols - left;
+    if (height == PUZZLE_ROWS && width == PUZZLE_COLS) {
+        vector<vector<int>> region(height, vector<int>(width));
+        for (int r = 0; r < height; r++) {
+            for (int c = 0; c < width; c++) {
+                int tile = _b.tiles[(top + r) * _b.cols + left + c];
+                int goal_cell = tile == 0 ? _b.rows * _b.cols - 1 : tile - 1;
+                int goal_r = goal_cell / _b.cols - top, goal_c = goal_cell % _b.cols - left;
+                region[r][c] = tile == 0 ? 0 : PUZZLE_GOAL[goal_r][goal_c];
+            }
+        }
+        SearchOptions options;
+        options.verbose = false;
+        SearchResult result = _context.solve(region, "Compact A* Manhattan", options);
+        for (char move : result.moves) {
+            int step = move == 'U' ? -_b.cols : move == 'D' ? _b.cols : move == 'L' ? -1 : 1;
+            _b.move_blank(_b.blank + step);
+        }
+    } else {
+        vector<int> tracked, goals;
+        for (int cell = 0; cell + 1 < _b.rows * _b.cols; cell++) {
+            if (free_cells[cell]) {
+                tracked.push_back(_b.find(cell + 1));
+                goals.push_back(cell);
+            }
+        }
+        reduction_search(_b, tracked, free_cells, [&](vector<int> &_t, int) { return _t == goals; });
+    }
+    for (int cell = 0; cell + 1 < _b.rows * _b.cols; cell++) {
+        if (_b.tiles[cell] != cell + 1) {
+            return "";
+        }
+    }
+
+    string moves;
+    for (char move : _b.moves) {
+        char reverse = move == 'U' ? 'D' : move == 'D' ? 'U' : move == 'L' ? 'R' : 'L';
+        if (!moves.empty() && moves.back() == reverse) {
+            moves.pop_back();
+        } else {
+            moves += move;
+        }
+    }
+    return moves;
+}
+
+// Handles "--reduce ROWS COLS [FILE] [--random N] [--seed S] [--print-moves]". Solves boards of up to 10x10
+// read from FILE (or standard input), one per line as tiles in row-major order, or N seeded random
+// solvable boards. Prints each solution's length next to the Manhattan distance lower bound.
+int run_reduction(int argc, char* argv[]) {
+    int rows = atoi(argv[2]), cols = atoi(argv[3]), random_count = -1;
+    uint64_t seed = 1;
+    bool print_moves = false;
+    string path;
+    for (int i = 4; i < argc; i++) {
+        string flag = argv[i];
+        if (flag == "--print-moves") {
+            print_moves = true;
+        } else if (i+1 < argc && flag == "--random") {
+            random_count = atoi(argv[++i]);
+        } else if (i+1 < argc && flag == "--seed") {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (flag[0] != '-') {
+            path = flag;
+        }
+    }
+    if (rows < 2 || cols < 2 || rows > 10 || cols > 10) {
+        cerr << "Boards must be between 2x2 and 10x10." << '\n';
+        return 1;
+    }
+    const int cells = rows * cols;
+
+    // Solvable iff the tiles' permutation parity matches the parity of the blank's distance from its goal
+    // cell, which covers every width and height.
+    auto solvable = [&](vector<int> &_tiles) {
+        int parity = 0, blank = 0;
+        vector<int> order(cells);
+        for (int i = 0; i < cells; i++) {
+            order[i] = _tiles[i] == 0 ? cells - 1 : _tiles[i] - 1;
+            if (_tiles[i] == 0) {
+                blank = i;
+            }
+        }
+        for (int i = 0; i < cells; i++) {
+            while (order[i] != i) {
+                swap(order[i], order[order[i]]);
+                parity ^= 1;
+            }
+        }
+        return parity == ((rows-1 - blank / cols + cols-1 - blank % cols) & 1);
+    };
+
+    vector<vector<int>> boards;
+    if (random_count >= 0) {
+        mt19937_64 rng(seed);
+        for (int n = 0; n < random_count; n++) {
+            vector<int> tiles(cells);
+            for (int i = 0; i < cells; i++) {
+                tiles[i] = i;
+            }
+            shuffle(tiles.begin(), tiles.end(), rng);
+            if (!solvable(tiles)) {
+                int a = tiles[0] == 0 ? 2 : 0, b = tiles[1] == 0 ? 2 : 1;
+                swap(tiles[a], tiles[b]);
+            }
+            boards.push_back(tiles);
+        }
+    } else {
+        ifstream file;
+        if (!path.empty()) {
+            file.open(path);
+            if (!file) {
+                cerr << "Unable to open \"" << path << "\"." << '\n';
+                return 1;
+            }
+        }
+        istream &in = path.empty() ? cin : file;
+        string line;
+        while (getline(in, line)) {
+            istringstream numbers(line);
+            vector<int> tiles;
+            int value;
+            while (numbers >> value) {
+                tiles.push_back(value);
+            }
+            if (!tiles.empty()) {
+                boards.push_back(tiles);
+            }
+        }
+    }
+
+    long long total_length = 0, total_bound = 0;
+    chrono::duration<double, milli> total_time(0);
+    SearchContext context;
+    for (size_t n = 0; n < boards.size(); n++) {
+        vector<int> &tiles = boards[n];
+        vector<int> sorted = tiles;
+        sort(sorted.begin(), sorted.end());
+        bool valid = (int)tiles.size() == cells;
+        for (int i = 0; valid && i < cells; i++) {
+            valid = sorted[i] == i;
+        }
+        if (!valid || !solvable(tiles)) {
+            cout << n << (valid ? " unsolvable" : " invalid") << '\n';
+            continue;
+        }
+
+        int bound = 0;
+        for (int i = 0; i < cells; i++) {
+            if (tiles[i] != 0) {
+                bound += abs(i / cols - (tiles[i]-1) / cols) + abs(i % cols - (tiles[i]-1) % cols);
+            }
+        }
+        LargeBoard board;
+        board.rows = rows;
+        board.cols = cols;
+        board.tiles = tiles;
+        board.blank = board.find(0);
+        auto start = chrono::steady_clock::now();
+        string moves = reduction_solve(board, context);
+        chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+        if (moves.empty() && bound > 0) {
+            cout << n << " failed" << '\n';
+            continue;
+        }
+
+        total_length += moves.size();
+        total_bound += bound;
+        total_time += elapsed;
+        cout << n << " length=" << moves.size() << " lower_bound=" << bound << " ratio=" << fixed << setprecision(2)
+             << (bound ? (double)moves.size() / bound : 1.0) << " ms=" << setprecision(3) << elapsed.count()
+             << defaultfloat << '\n';
+        if (print_moves) {
+            cout << (moves.empty() ? "-" : moves) << '\n';
+        }
+    }
+    cout << "Total length: " << total_length << ", lower bound: " << total_bound << ", time: " << fixed
+         << setprecision(3) << total_time.count() << " ms" << defaultfloat << '\n';
+    return 0;
+}
+
+
+// Starts recording every expansion to a trace file; false if the file cannot be opened.
+bool start_expansion_trace(string _path) {
+    expansion_tracer = new ExpansionTracer();
+    if (!expansion_tracer->start(_path)) {
+        cerr << "Unable to open \"" << _path << "\" for writing." << '\n';
+        delete expansion_tracer;
+        expansion_tracer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+// Flushes and closes the trace, if one is being recorded.
+void stop_expansion_trace() {
+    if (expansion_tracer == nullptr) {
+        return;
+    }
+    ExpansionTracer* tracer = expansion_tracer;
+    expansion_tracer = nullptr;
+    uint64_t dropped = tracer->stop();
+    cerr << "Trace: " << tracer->written << " expansions written";
+    if (dropped > 0) {
+        cerr << ", " << dropped << " dropped because the writer fell behind";
+    }
+    cerr << '\n';
+    delete tracer;
+}
+
+// Handles "--trace-report FILE": reads a trace written with --trace and prints the expansions per f layer
+// as a histogram and how often the blank tile sat on each cell as a heatmap.
+int run_trace_report(int argc, char* argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: --trace-report FILE" << '\n';
+        return 1;
+    }
+    ifstream in(argv[2], ios::binary);
+    char magic[7];
+    int32_t shape = 0;
+    in.read(magic, 7);
+    in.read(reinterpret_cast<char*>(&shape), sizeof(shape));
+    const int rows = shape < 256 ? shape : shape / 256, cols = shape < 256 ? shape : shape % 256;
+    if (!in || string(magic, 7) != "NPZTRC1" || rows < 1 || rows > 16 || cols < 1 || cols > 16) {
+        cerr << "\"" << argv[2] << "\" is not a trace file." << '\n';
+        return 1;
+    }
+
+    map<int, long long> f_layers;
+    vector<long long> blank_counts(rows * cols, 0);
+    set<int> threads;
+    long long records = 0, total_ns = 0;
+    uint32_t max_frontier = 0;
+    vector<TraceRecord> chunk(1 << 16);
+    while (in) {
+        in.read(reinterpret_cast<char*>(chunk.data()), chunk.size() * sizeof(TraceRecord));
+        size_t count = in.gcount() / sizeof(TraceRecord);
+        for (size_t i = 0; i < count; i++) {
+            const TraceRecord &r = chunk[i];
+            f_layers[r.f]++;
+            if (r.blank < blank_counts.size()) {
+                blank_counts[r.blank]++;
+            }
+            max_frontier = max(max_frontier, r.frontier);
+            if (threads.insert(r.thread).second) {
+                continue;   // A thread's first delta covers the time before its search started.
+            }
+            total_ns += r.delta_ns;
+        }
+        records += count;
+    }
+
+    cout << "Expansions: " << records << " from " << threads.size() << " thread(s), mean "
+         << fixed << setprecision(1) << (records > (long long)threads.size() ? (double)total_ns / (records - threads.size()) : 0.0)
+         << " ns apart, max frontier " << max_frontier << defaultfloat << '\n' << '\n';
+
+    long long largest = 0;
+    for (auto &layer : f_layers) {
+        largest = max(largest, layer.second);
+    }
+    cout << "Expansions per f layer:" << '\n';
+    for (auto &layer : f_layers) {
+        cout << setw(5) << layer.first << "  " << setw(12) << layer.second << "  "
+             << string((size_t)(50.0 * layer.second / largest + 0.5), '#') << '\n';
+    }
+    cout << '\n' << "Blank position (% of expansions):" << '\n' << fixed << setprecision(1);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            cout << setw(7) << (records ? 100.0 * blank_counts[i * cols + j] / records : 0.0);
+        }
+        cout << '\n';
+    }
+    cout << defaultfloat << '\n';
+    return 0;
+}